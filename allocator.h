@@ -0,0 +1,355 @@
+#pragma once
+
+#include <linux/mempolicy.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "report.h"
+
+namespace hyperlink {
+
+namespace numa {
+
+// NUMA nodes that are online, e.g., {0, 1} if sysfs lists "0-1".
+inline std::vector<int> OnlineNodes() {
+    std::vector<int> nodes;
+
+    std::ifstream in("/sys/devices/system/node/online");
+    std::string range;
+    while (std::getline(in, range, ',')) {
+        const std::size_t dash = range.find('-');
+        const int first = std::stoi(range.substr(0, dash));
+        const int last = dash == std::string::npos
+                             ? first
+                             : std::stoi(range.substr(dash + 1));
+        for (int node = first; node <= last; ++node) {
+            nodes.push_back(node);
+        }
+    }
+
+    if (nodes.empty()) {
+        nodes.push_back(0);
+    }
+    return nodes;
+}
+
+// Interleaves the pages of [data, data + bytes) round-robin across all online
+// nodes. Must be called before the pages are touched; does nothing on
+// single-node machines or if the kernel does not support memory policies.
+inline bool Interleave(void *data, const std::size_t bytes) {
+    static const std::vector<int> nodes = OnlineNodes();
+    if (nodes.size() < 2 || bytes == 0) {
+        return false;
+    }
+
+    constexpr std::size_t kBits = 8 * sizeof(unsigned long);
+    std::vector<unsigned long> mask(nodes.back() / kBits + 1);
+    for (const int node : nodes) {
+        mask[node / kBits] |= 1ul << (node % kBits);
+    }
+
+    return syscall(SYS_mbind, data, bytes, MPOL_INTERLEAVE, mask.data(),
+                   mask.size() * kBits + 1, 0) == 0;
+}
+
+// Number of pages of [data, data + bytes) that reside on each node, estimated
+// from up to `max_samples` evenly spaced pages. Pages that were not touched
+// yet are not counted. Returns an empty vector if the kernel does not support
+// querying the placement.
+inline std::vector<std::uint64_t> Placement(const void *data,
+                                            const std::size_t bytes,
+                                            const std::size_t max_samples =
+                                                4096) {
+    const std::size_t page_size = sysconf(_SC_PAGESIZE);
+    const std::size_t num_pages = (bytes + page_size - 1) / page_size;
+    const std::size_t step = std::max<std::size_t>(1, num_pages / max_samples);
+
+    std::vector<void *> pages;
+    const std::uintptr_t first =
+        reinterpret_cast<std::uintptr_t>(data) / page_size * page_size;
+    for (std::size_t page = 0; page < num_pages; page += step) {
+        pages.push_back(reinterpret_cast<void *>(first + page * page_size));
+    }
+
+    std::vector<int> status(pages.size());
+    if (syscall(SYS_move_pages, 0, pages.size(), pages.data(), nullptr,
+                status.data(), 0) != 0) {
+        return {};
+    }
+
+    std::vector<std::uint64_t> placement;
+    for (const int node : status) {
+        if (node >= 0) {
+            if (placement.size() <= static_cast<std::size_t>(node)) {
+                placement.resize(node + 1);
+            }
+            placement[node] += step;
+        }
+    }
+    return placement;
+}
+
+// Prints the per-node placement of a buffer and adds it to the report.
+inline void ReportPlacement(const std::string &name, const void *data,
+                            const std::size_t bytes) {
+    const std::vector<std::uint64_t> placement = Placement(data, bytes);
+
+    std::uint64_t total = 0;
+    for (const std::uint64_t pages : placement) {
+        total += pages;
+    }
+    if (total == 0) {
+        return;
+    }
+
+    std::stringstream ss;
+    for (std::size_t node = 0; node < placement.size(); ++node) {
+        ss << (node > 0 ? " " : "") << "node" << node << "="
+           << 100 * placement[node] / total << "%";
+    }
+    std::cout << "\tNUMA placement of " << name << ": " << ss.str()
+              << std::endl;
+    report::SetProperty("numa_placement_" + name, ss.str());
+}
+
+}  // namespace numa
+
+namespace huge_pages {
+
+constexpr std::size_t kSize = 2 * 1024 * 1024;
+
+enum class Mode { kOff, kTransparent, kExplicit };
+
+// Huge pages are opt-in: HYPERLINK_HUGE_PAGES=transparent advises the kernel
+// to back buffers and file mappings with transparent huge pages,
+// HYPERLINK_HUGE_PAGES=explicit allocates buffers from the hugetlbfs pool and
+// falls back to transparent huge pages if the pool is too small.
+inline Mode GetMode() {
+    static const Mode mode = [] {
+        const char *env = std::getenv("HYPERLINK_HUGE_PAGES");
+        const std::string value = env ? env : "";
+        if (value == "explicit") {
+            return Mode::kExplicit;
+        }
+        if (value == "transparent") {
+            return Mode::kTransparent;
+        }
+        if (!value.empty() && value != "off") {
+            std::cerr << "warning: ignoring unknown value of "
+                         "HYPERLINK_HUGE_PAGES: "
+                      << value << "\n";
+        }
+        return Mode::kOff;
+    }();
+    return mode;
+}
+
+// Size of the mapping used for a buffer of `bytes` bytes.
+inline std::size_t MappedSize(const std::size_t bytes) {
+    if (GetMode() == Mode::kOff) {
+        return bytes;
+    }
+    return (bytes + kSize - 1) / kSize * kSize;
+}
+
+// Maps `bytes` bytes of anonymous memory, which must be a multiple of kSize,
+// aligned to a huge page boundary and backed by huge pages if possible.
+inline void *Map(const std::size_t bytes) {
+    if (GetMode() == Mode::kExplicit) {
+        void *data = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (data != MAP_FAILED) {
+            return data;
+        }
+
+        static bool warned = false;
+        if (!warned) {
+            std::cerr << "warning: not enough explicit huge pages available, "
+                         "falling back to transparent huge pages\n";
+            warned = true;
+        }
+    }
+
+    // Over-allocate by one huge page and trim the mapping to the next
+    // boundary, otherwise the kernel cannot use huge pages for the first and
+    // last few MB
+    char *raw = static_cast<char *>(
+        mmap(nullptr, bytes + kSize, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0));
+    if (raw == MAP_FAILED) {
+        return MAP_FAILED;
+    }
+
+    char *data = reinterpret_cast<char *>(
+        (reinterpret_cast<std::uintptr_t>(raw) + kSize - 1) / kSize * kSize);
+    if (data > raw) {
+        munmap(raw, data - raw);
+    }
+    munmap(data + bytes, raw + kSize - data);
+
+    madvise(data, bytes, MADV_HUGEPAGE);
+    return data;
+}
+
+// Advises the kernel on the access pattern of a file mapping: sequential
+// mappings are read ahead aggressively, and all mappings are backed by huge
+// pages if enabled (which requires kernel support for huge pages in the page
+// cache).
+inline void AdviseFileMapping(void *data, const std::size_t length,
+                              const bool sequential) {
+    if (sequential) {
+        madvise(data, length, MADV_SEQUENTIAL);
+    }
+    if (GetMode() != Mode::kOff) {
+        madvise(data, length, MADV_HUGEPAGE);
+    }
+}
+
+// Number of bytes of [data, data + bytes) that are backed by huge pages,
+// according to /proc/self/smaps.
+inline std::uint64_t Coverage(const void *data, const std::size_t bytes) {
+    const std::uintptr_t first = reinterpret_cast<std::uintptr_t>(data);
+    const std::uintptr_t last = first + bytes;
+
+    std::ifstream in("/proc/self/smaps");
+    std::string line;
+    bool overlaps = false;
+    std::uint64_t coverage = 0;
+
+    while (std::getline(in, line)) {
+        const std::size_t colon = line.find(':');
+        const std::size_t dash = line.find('-');
+
+        if (dash != std::string::npos &&
+            (colon == std::string::npos || dash < colon)) {
+            // Header of the next mapping: <start>-<end> <perms> ...
+            const std::uintptr_t start =
+                std::stoull(line.substr(0, dash), nullptr, 16);
+            const std::uintptr_t end =
+                std::stoull(line.substr(dash + 1), nullptr, 16);
+            overlaps = start < last && first < end;
+        } else if (overlaps && colon != std::string::npos) {
+            const std::string key = line.substr(0, colon);
+            if (key == "AnonHugePages" || key == "FilePmdMapped" ||
+                key == "Private_Hugetlb" || key == "Shared_Hugetlb") {
+                coverage += std::stoull(line.substr(colon + 1)) * 1024;
+            }
+        }
+    }
+
+    return std::min<std::uint64_t>(coverage, bytes);
+}
+
+// Prints which share of a buffer is backed by huge pages and adds it to the
+// report; does nothing unless huge pages were requested.
+inline void ReportCoverage(const std::string &name, const void *data,
+                           const std::size_t bytes) {
+    if (GetMode() == Mode::kOff || bytes == 0) {
+        return;
+    }
+
+    const std::uint64_t coverage = Coverage(data, bytes);
+    const std::string share = std::to_string(100 * coverage / bytes) + "%";
+    std::cout << "\tHuge pages backing " << name << ": " << share << " ("
+              << coverage / 1024 / 1024 << " of " << bytes / 1024 / 1024
+              << " MB)" << std::endl;
+    report::SetProperty("huge_pages_" + name, share);
+}
+
+}  // namespace huge_pages
+
+// Allocator for the large edge buffers: memory is mapped directly from the
+// kernel and interleaved across all NUMA nodes, so that the threads of the
+// parallel sort access local and remote memory evenly instead of all pages
+// ending up on the node of the thread that touched them first. Optionally, the
+// buffers are backed by huge pages, see huge_pages::GetMode().
+template <typename T>
+class BufferAllocator {
+   public:
+    using value_type = T;
+
+    BufferAllocator() = default;
+
+    template <typename U>
+    BufferAllocator(const BufferAllocator<U> &) {}
+
+    T *allocate(const std::size_t n) {
+        const std::size_t bytes = huge_pages::MappedSize(n * sizeof(T));
+        void *data =
+            huge_pages::GetMode() == huge_pages::Mode::kOff
+                ? mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0)
+                : huge_pages::Map(bytes);
+        if (data == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+
+        numa::Interleave(data, bytes);
+        return static_cast<T *>(data);
+    }
+
+    void deallocate(T *data, const std::size_t n) {
+        munmap(data, huge_pages::MappedSize(n * sizeof(T)));
+    }
+
+    // Default-initializes elements instead of value-initializing them, i.e.,
+    // resize() does not zero-fill the buffer on a single thread. Elements of
+    // trivial types are not touched at all, so that the pages are first
+    // touched by whichever threads fill the buffer.
+    template <typename U, typename... Args>
+    void construct(U *ptr, Args &&...args) {
+        if constexpr (sizeof...(Args) > 0) {
+            ::new (static_cast<void *>(ptr)) U(std::forward<Args>(args)...);
+        } else if constexpr (!std::is_trivially_copy_constructible_v<U> ||
+                             !std::is_trivially_destructible_v<U>) {
+            ::new (static_cast<void *>(ptr)) U;
+        }
+    }
+
+    template <typename U>
+    bool operator==(const BufferAllocator<U> &) const {
+        return true;
+    }
+};
+
+template <typename T>
+using Buffer = std::vector<T, BufferAllocator<T>>;
+
+// Size of the physical memory in bytes. Since Buffer pages are only committed
+// when they are first touched, reserving a Buffer of this size merely reserves
+// address space, and the Buffer can then grow up to it without reallocating.
+inline std::uint64_t PhysicalMemory() {
+    return static_cast<std::uint64_t>(sysconf(_SC_PHYS_PAGES)) *
+           static_cast<std::uint64_t>(sysconf(_SC_PAGESIZE));
+}
+
+// Memory in bytes that can be committed without swapping, i.e., MemAvailable,
+// which also counts reclaimable caches; falls back to the free memory.
+inline std::uint64_t AvailableMemory() {
+    std::ifstream meminfo("/proc/meminfo");
+    std::string key;
+    std::uint64_t kib = 0;
+    std::string unit;
+    while (meminfo >> key >> kib >> unit) {
+        if (key == "MemAvailable:") {
+            return kib * 1024;
+        }
+    }
+    return static_cast<std::uint64_t>(sysconf(_SC_AVPHYS_PAGES)) *
+           static_cast<std::uint64_t>(sysconf(_SC_PAGESIZE));
+}
+
+}  // namespace hyperlink
@@ -0,0 +1,228 @@
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "parallel.h"
+#include "rmat.h"
+
+using namespace hyperlink;
+
+class StageTable {
+   public:
+    void Add(const std::string &name, const double seconds,
+             const std::uint64_t edges, const std::uint64_t bytes) {
+        _stages.push_back({
+            .name = name,
+            .seconds = seconds,
+            .edges = edges,
+            .bytes = bytes,
+        });
+    }
+
+    void Print() const {
+        std::cout << std::left << std::setw(28) << "Stage" << std::right
+                  << std::setw(12) << "Time [s]" << std::setw(14)
+                  << "Edges/s" << std::setw(12) << "GB/s" << std::endl;
+        for (const Stage &stage : _stages) {
+            const double seconds = std::max(stage.seconds, 1e-9);
+            std::cout << std::left << std::setw(28) << stage.name << std::right
+                      << std::fixed << std::setprecision(3) << std::setw(12)
+                      << stage.seconds << std::setw(14) << std::setprecision(0)
+                      << stage.edges / seconds << std::setw(12)
+                      << std::setprecision(3)
+                      << stage.bytes / seconds / 1024 / 1024 / 1024
+                      << std::endl;
+        }
+    }
+
+   private:
+    struct Stage {
+        std::string name;
+        double seconds;
+        std::uint64_t edges;
+        std::uint64_t bytes;
+    };
+
+    std::vector<Stage> _stages;
+};
+
+// Returns the number following "<key>": in a line of a report.
+double ReportField(const std::string &line, const std::string &key) {
+    const std::size_t pos = line.find("\"" + key + "\": ");
+    if (pos == std::string::npos) {
+        throw std::runtime_error("report lacks " + key);
+    }
+    return std::stod(line.substr(pos + key.size() + 4));
+}
+
+// Adds the top-level phases of a report written by --report, one per line,
+// and the whole run of the tool as stages.
+void AddReport(StageTable &table, const std::string &tool,
+               const std::string &filename) {
+    std::ifstream in(filename);
+    if (!in) {
+        throw std::runtime_error("cannot read report " + filename);
+    }
+
+    const std::string kPhase = "{\"name\": \"";
+    for (std::string line; std::getline(in, line);) {
+        const bool total = line.find("\"total\": ") != std::string::npos;
+        const std::size_t name = line.find(kPhase);
+        if (!total && (name == std::string::npos ||
+                       ReportField(line, "depth") != 0)) {
+            continue;
+        }
+
+        const std::string stage =
+            total ? tool
+                  : tool + ":" +
+                        line.substr(name + kPhase.size(),
+                                    line.find('"', name + kPhase.size()) -
+                                        name - kPhase.size());
+        table.Add(stage, ReportField(line, "wall_time_s"),
+                  static_cast<std::uint64_t>(ReportField(line, "edges")),
+                  static_cast<std::uint64_t>(ReportField(line, "bytes_read") +
+                                             ReportField(line,
+                                                         "bytes_written")));
+    }
+}
+
+// Runs a tool from the directory of this executable with --report and its
+// console output appended to `log_filename`; throws if the tool fails.
+void RunTool(const std::string &tool, std::vector<std::string> args,
+             const std::string &report_filename,
+             const std::string &log_filename) {
+    const std::filesystem::path directory =
+        std::filesystem::read_symlink("/proc/self/exe").parent_path();
+    const std::string path = (directory / tool).string();
+
+    args.insert(args.begin(), {path, "--report=" + report_filename});
+    std::vector<char *> argv;
+    for (std::string &arg : args) {
+        argv.push_back(arg.data());
+    }
+    argv.push_back(nullptr);
+
+    std::cout << tool << " ..." << std::endl;
+    const pid_t pid = fork();
+    if (pid == 0) {
+        const int log = open(log_filename.c_str(),
+                             O_WRONLY | O_CREAT | O_APPEND, S_IRUSR | S_IWUSR);
+        if (log >= 0) {
+            dup2(log, STDOUT_FILENO);
+            dup2(log, STDERR_FILENO);
+        }
+        execv(path.c_str(), argv.data());
+        _exit(127);
+    }
+
+    int status = 0;
+    if (pid < 0 || waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) ||
+        WEXITSTATUS(status) != 0) {
+        throw std::runtime_error(path + " failed, see " + log_filename);
+    }
+}
+
+// Runs the conversion tools on a synthetic R-MAT graph and reports the
+// throughput of every phase, as recorded by the tools themselves.
+int main(const int argc, const char *argv[]) {
+    if (argc < 4) {
+        std::cerr << "usage: ./bench <scale> <edge factor> <work directory> "
+                     "[<seed>]\n";
+        std::cerr << "txt2sbin, revsbin, edges2parhip and parhip2metis must "
+                     "reside next to the bench executable.\n";
+        std::exit(1);
+    }
+
+    rmat::Parameters p;
+    p.scale = std::stoi(argv[1]);
+    p.num_edges = std::stoull(argv[2]) << p.scale;
+    const std::filesystem::path directory = argv[3];
+    if (argc > 4) {
+        p.seed = std::stoull(argv[4]);
+    }
+
+    if (p.scale < 1 || p.scale > 32) {
+        std::cerr << "error: scale must be in [1, 32]\n";
+        std::exit(1);
+    }
+
+    auto path = [&](const std::string &name) {
+        return (directory / ("bench." + name)).string();
+    };
+    const std::string txt_filename = path("txt");
+    const std::string bin_filename = path("bin");
+    const std::string rev_filename = path("rev.bin");
+    const std::string parhip_filename = path("parhip");
+    const std::string metis_filename = path("metis");
+    const std::string log_filename = path("log");
+
+    std::vector<std::string> temporary_files = {txt_filename,
+                                                log_filename};
+    for (const std::string &filename :
+         {bin_filename, rev_filename, parhip_filename, metis_filename}) {
+        temporary_files.push_back(filename);
+        temporary_files.push_back(filename + ".crc");
+    }
+    for (const std::string &filename : temporary_files) {
+        std::filesystem::remove(filename);
+    }
+
+    std::cout << "Generating R-MAT graph with 2^" << p.scale << " vertices and "
+              << p.num_edges << " edges ..." << std::endl;
+    std::cout << "Threads: " << NumThreads() << std::endl;
+
+    StageTable table;
+    try {
+        const auto start = std::chrono::steady_clock::now();
+        const std::uint64_t txt_size = rmat::WriteTextEdgeList(p, txt_filename);
+        table.Add("generate",
+                  std::chrono::duration<double>(
+                      std::chrono::steady_clock::now() - start)
+                      .count(),
+                  p.num_edges, txt_size);
+
+        // Upper bound on the number of edges in billions
+        const std::string max_edges =
+            std::to_string((p.num_edges + 999'999'999) / 1'000'000'000);
+
+        const std::vector<std::pair<std::string, std::vector<std::string>>>
+            runs = {
+                {"txt2sbin", {max_edges, txt_filename, bin_filename}},
+                {"revsbin", {bin_filename, rev_filename}},
+                {"edges2parhip",
+                 {bin_filename, rev_filename, parhip_filename}},
+                {"parhip2metis", {parhip_filename, metis_filename}},
+            };
+        for (const auto &[tool, args] : runs) {
+            const std::string report_filename = path(tool + ".json");
+            temporary_files.push_back(report_filename);
+            RunTool(tool, args, report_filename, log_filename);
+            AddReport(table, tool, report_filename);
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "error: " << e.what() << "\n";
+        std::exit(1);
+    }
+
+    table.Print();
+
+    for (const std::string &filename : temporary_files) {
+        std::filesystem::remove(filename);
+    }
+
+    std::cout << "Done." << std::endl;
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace hyperlink::checkpoint {
+
+// Forces the contents of a file or directory to stable storage.
+inline bool Sync(const std::string &path) {
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    const bool ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
+}
+
+// Identifies the inputs of a conversion by their names, sizes and
+// modification times; a checkpoint is only resumed if this did not change.
+inline std::string Fingerprint(const std::vector<std::string> &filenames,
+                               const std::string &extra = "") {
+    std::string fingerprint = extra;
+    for (const std::string &filename : filenames) {
+        struct stat info {};
+        stat(filename.c_str(), &info);
+        fingerprint += "|" + filename + ":" + std::to_string(info.st_size) +
+                       ":" + std::to_string(info.st_mtime);
+    }
+    for (char &ch : fingerprint) {
+        if (ch == '\n') {
+            ch = ' ';
+        }
+    }
+    return fingerprint;
+}
+
+// Persistent progress of a conversion, stored as a manifest of key/value pairs
+// in a directory that also holds the checkpointed data files. The manifest is
+// replaced atomically and only after the data files were synced, i.e., it only
+// refers to data files that were written completely. A default-constructed
+// checkpoint is disabled and ignores all updates.
+class Checkpoint {
+   public:
+    Checkpoint() = default;
+
+    Checkpoint(const std::string &directory, const std::string &fingerprint)
+        : _directory(directory), _fingerprint(fingerprint) {
+        std::filesystem::create_directories(_directory);
+
+        std::ifstream in(ManifestPath());
+        if (!in) {
+            return;
+        }
+
+        std::string stored_fingerprint;
+        std::getline(in, stored_fingerprint);
+        if (stored_fingerprint != _fingerprint) {
+            std::cout << "Checkpoint in " << _directory
+                      << " belongs to different inputs, starting over"
+                      << std::endl;
+            return;
+        }
+
+        std::string key;
+        std::uint64_t value;
+        while (in >> key >> value) {
+            _values[key] = value;
+        }
+        if (!_values.empty()) {
+            std::cout << "Resuming from checkpoint in " << _directory
+                      << std::endl;
+        }
+    }
+
+    [[nodiscard]] bool Enabled() const { return !_directory.empty(); }
+
+    [[nodiscard]] std::uint64_t Get(const std::string &key,
+                                    const std::uint64_t fallback = 0) const {
+        const auto it = _values.find(key);
+        return it == _values.end() ? fallback : it->second;
+    }
+
+    void Set(const std::string &key, const std::uint64_t value) {
+        _values[key] = value;
+    }
+
+    // Path of a data file stored in the checkpoint directory.
+    [[nodiscard]] std::string Path(const std::string &name) const {
+        return (std::filesystem::path(_directory) / name).string();
+    }
+
+    // Persists all values once the data files they refer to reached stable
+    // storage, so that the checkpoint survives a crash of the machine. The
+    // data files must be written and flushed before.
+    void Commit(const std::vector<std::string> &data_filenames = {}) const {
+        if (!Enabled()) {
+            return;
+        }
+
+        for (const std::string &filename : data_filenames) {
+            if (!Sync(filename)) {
+                std::cerr << "warning: cannot sync " << filename
+                          << ", checkpoint not updated\n";
+                return;
+            }
+        }
+
+        const std::string tmp_path = ManifestPath() + ".tmp";
+        {
+            std::ofstream out(tmp_path, std::ios::trunc);
+            out << _fingerprint << "\n";
+            for (const auto &[key, value] : _values) {
+                out << key << " " << value << "\n";
+            }
+            out.flush();
+            if (!out || !Sync(tmp_path)) {
+                std::cerr << "warning: cannot write checkpoint to "
+                          << _directory << "\n";
+                return;
+            }
+        }
+        std::filesystem::rename(tmp_path, ManifestPath());
+        if (!Sync(_directory)) {
+            std::cerr << "warning: cannot sync checkpoint directory "
+                      << _directory << "\n";
+        }
+    }
+
+    // Deletes the checkpoint once the conversion is complete.
+    void Remove() {
+        if (Enabled()) {
+            std::filesystem::remove_all(_directory);
+            _values.clear();
+        }
+    }
+
+   private:
+    [[nodiscard]] std::string ManifestPath() const { return Path("manifest"); }
+
+    std::string _directory;
+    std::string _fingerprint;
+    std::map<std::string, std::uint64_t> _values;
+};
+
+}  // namespace hyperlink::checkpoint
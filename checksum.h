@@ -0,0 +1,315 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
+
+#include "parallel.h"
+
+// Block checksums of binary outputs. Every output file `foo` gets a sidecar
+// `foo.crc` that stores the CRC32C of every block of kBlockSize bytes, such
+// that corruption can be detected and localized without regenerating the file.
+namespace hyperlink::checksum {
+
+constexpr std::uint64_t kBlockSize = 1024 * 1024;
+constexpr std::uint64_t kMagic = 0x4332335243434c48;  // "HLCCR32C"
+
+namespace internal {
+
+// Tables for the software fallback; slicing by 8 bytes.
+constexpr std::array<std::array<std::uint32_t, 256>, 8> BuildTables() {
+    constexpr std::uint32_t kPolynomial = 0x82f63b78;
+
+    std::array<std::array<std::uint32_t, 256>, 8> tables{};
+    for (std::uint32_t i = 0; i < 256; ++i) {
+        std::uint32_t crc = i;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc >> 1) ^ ((crc & 1) ? kPolynomial : 0);
+        }
+        tables[0][i] = crc;
+    }
+    for (std::uint32_t i = 0; i < 256; ++i) {
+        for (int t = 1; t < 8; ++t) {
+            tables[t][i] =
+                (tables[t - 1][i] >> 8) ^ tables[0][tables[t - 1][i] & 0xff];
+        }
+    }
+    return tables;
+}
+
+inline constexpr auto kTables = BuildTables();
+
+inline std::uint32_t ExtendSoftware(std::uint32_t crc, const unsigned char *p,
+                                    std::size_t len) {
+    for (; len >= 8; p += 8, len -= 8) {
+        std::uint64_t word;
+        std::memcpy(&word, p, sizeof(word));
+        word ^= crc;
+        crc = kTables[7][word & 0xff] ^ kTables[6][(word >> 8) & 0xff] ^
+              kTables[5][(word >> 16) & 0xff] ^
+              kTables[4][(word >> 24) & 0xff] ^
+              kTables[3][(word >> 32) & 0xff] ^
+              kTables[2][(word >> 40) & 0xff] ^
+              kTables[1][(word >> 48) & 0xff] ^ kTables[0][word >> 56];
+    }
+    for (; len > 0; ++p, --len) {
+        crc = (crc >> 8) ^ kTables[0][(crc ^ *p) & 0xff];
+    }
+    return crc;
+}
+
+#if defined(__x86_64__)
+// Uses the CRC32 instruction of SSE 4.2, which computes CRC32C.
+__attribute__((target("sse4.2"))) inline std::uint32_t ExtendHardware(
+    std::uint32_t crc, const unsigned char *p, std::size_t len) {
+    std::uint64_t crc64 = crc;
+    for (; len >= 8; p += 8, len -= 8) {
+        std::uint64_t word;
+        std::memcpy(&word, p, sizeof(word));
+        crc64 = _mm_crc32_u64(crc64, word);
+    }
+    crc = static_cast<std::uint32_t>(crc64);
+    for (; len > 0; ++p, --len) {
+        crc = _mm_crc32_u8(crc, *p);
+    }
+    return crc;
+}
+#endif
+
+}  // namespace internal
+
+// Extends `crc` by [data, data + len), i.e., Crc32c(b, Crc32c(a)) is the
+// checksum of a followed by b. Uses SSE 4.2 if the CPU supports it.
+inline std::uint32_t Crc32c(const void *data, const std::size_t len,
+                            const std::uint32_t crc = 0) {
+    const auto *p = static_cast<const unsigned char *>(data);
+
+#if defined(__x86_64__)
+    static const bool has_sse42 = __builtin_cpu_supports("sse4.2");
+    if (has_sse42) {
+        return ~internal::ExtendHardware(~crc, p, len);
+    }
+#endif
+    return ~internal::ExtendSoftware(~crc, p, len);
+}
+
+inline std::string SidecarFilename(const std::string &filename) {
+    return filename + ".crc";
+}
+
+inline std::uint64_t NumBlocks(const std::uint64_t length) {
+    return (length + kBlockSize - 1) / kBlockSize;
+}
+
+struct Sidecar {
+    std::uint64_t length = 0;
+    std::vector<std::uint32_t> crcs;
+};
+
+// Checksums of [data, data + length), computed block by block on all threads.
+inline std::vector<std::uint32_t> ComputeBlocks(const void *data,
+                                                const std::uint64_t length) {
+    const auto *bytes = static_cast<const char *>(data);
+
+    std::vector<std::uint32_t> crcs(NumBlocks(length));
+    ParallelFor(0, crcs.size(), 1,
+                [&](int, const std::uint64_t first, const std::uint64_t last) {
+                    for (std::uint64_t b = first; b < last; ++b) {
+                        const std::uint64_t begin = b * kBlockSize;
+                        crcs[b] = Crc32c(bytes + begin,
+                                         std::min(length - begin, kBlockSize));
+                    }
+                });
+    return crcs;
+}
+
+// Writes the sidecar of `filename`.
+inline void WriteSidecar(const std::string &filename, const Sidecar &sidecar) {
+    using namespace std::literals;
+
+    const std::uint64_t header[3] = {kMagic, kBlockSize, sidecar.length};
+    std::ofstream out(SidecarFilename(filename),
+                      std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char *>(header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(sidecar.crcs.data()),
+              sidecar.crcs.size() * sizeof(std::uint32_t));
+    if (!out) {
+        throw std::runtime_error("cannot write to "s +
+                                 SidecarFilename(filename));
+    }
+}
+
+// Writes the sidecar of `filename`, whose contents are [data, data + length).
+inline void WriteSidecar(const std::string &filename, const void *data,
+                         const std::uint64_t length) {
+    WriteSidecar(filename, {.length = length,
+                            .crcs = ComputeBlocks(data, length)});
+}
+
+inline Sidecar ReadSidecar(const std::string &filename) {
+    using namespace std::literals;
+
+    std::ifstream in(SidecarFilename(filename), std::ios::binary);
+    std::uint64_t header[3] = {0, 0, 0};
+    in.read(reinterpret_cast<char *>(header), sizeof(header));
+    if (!in || header[0] != kMagic || header[1] != kBlockSize) {
+        throw std::runtime_error("missing or invalid checksums "s +
+                                 SidecarFilename(filename));
+    }
+
+    Sidecar sidecar{.length = header[2], .crcs = {}};
+    sidecar.crcs.resize(NumBlocks(sidecar.length));
+    in.read(reinterpret_cast<char *>(sidecar.crcs.data()),
+            sidecar.crcs.size() * sizeof(std::uint32_t));
+    if (!in) {
+        throw std::runtime_error("truncated checksums "s +
+                                 SidecarFilename(filename));
+    }
+    return sidecar;
+}
+
+// Computes the checksums of a file that is written front to back in pieces
+// of arbitrary size.
+class StreamChecksums {
+   public:
+    void Append(const void *data, std::size_t len) {
+        const auto *bytes = static_cast<const char *>(data);
+        while (len > 0) {
+            const std::size_t take =
+                std::min<std::uint64_t>(len, kBlockSize - _fill);
+            _crc = Crc32c(bytes, take, _crc);
+            _fill += take;
+            _sidecar.length += take;
+            bytes += take;
+            len -= take;
+
+            if (_fill == kBlockSize) {
+                _sidecar.crcs.push_back(_crc);
+                _crc = 0;
+                _fill = 0;
+            }
+        }
+    }
+
+    // Appends bytes [Length(), end) of the file, e.g., after resuming an
+    // interrupted run or for parts of the file that were written through
+    // another stream.
+    void AppendFromFile(const std::string &filename, const std::uint64_t end) {
+        using namespace std::literals;
+        constexpr std::uint64_t kChunkSize = 64 * kBlockSize;
+
+        std::ifstream in(filename, std::ios::binary);
+        in.seekg(_sidecar.length, std::ios::beg);
+
+        std::vector<char> buffer(std::min(kChunkSize, end - Length()));
+        while (Length() < end) {
+            const std::uint64_t len = std::min(kChunkSize, end - Length());
+            in.read(buffer.data(), len);
+            if (!in) {
+                throw std::runtime_error("cannot read from "s + filename);
+            }
+            Append(buffer.data(), len);
+        }
+    }
+
+    [[nodiscard]] std::uint64_t Length() const { return _sidecar.length; }
+
+    void Write(const std::string &filename) const {
+        Sidecar sidecar = _sidecar;
+        if (_fill > 0) {
+            sidecar.crcs.push_back(_crc);
+        }
+        WriteSidecar(filename, sidecar);
+    }
+
+   private:
+    Sidecar _sidecar;
+    std::uint32_t _crc = 0;
+    std::uint64_t _fill = 0;
+};
+
+// Checks blocks [first_block, last_block) of a file on all threads, where
+// `data` points to the contents of block first_block; returns the corrupted
+// blocks in increasing order.
+inline std::vector<std::uint64_t> VerifyBlocks(const void *data,
+                                               const Sidecar &sidecar,
+                                               const std::uint64_t first_block,
+                                               const std::uint64_t last_block) {
+    const auto *bytes = static_cast<const char *>(data);
+
+    std::vector<std::vector<std::uint64_t>> bad(NumThreads());
+    ParallelFor(first_block, last_block, 1,
+                [&](const int thread_id, const std::uint64_t first,
+                    const std::uint64_t last) {
+                    for (std::uint64_t b = first; b < last; ++b) {
+                        const std::uint64_t begin = b * kBlockSize;
+                        const std::uint32_t crc = Crc32c(
+                            bytes + (b - first_block) * kBlockSize,
+                            std::min(sidecar.length - begin, kBlockSize));
+                        if (crc != sidecar.crcs[b]) {
+                            bad[thread_id].push_back(b);
+                        }
+                    }
+                });
+
+    std::vector<std::uint64_t> all;
+    for (const std::vector<std::uint64_t> &local : bad) {
+        all.insert(all.end(), local.begin(), local.end());
+    }
+    std::sort(all.begin(), all.end());
+    return all;
+}
+
+// Reads `nbytes` bytes at `offset` into `to`, after checking the checksums of
+// all blocks they touch; the blocks are read as a whole.
+template <typename Data>
+void ReadVerified(std::ifstream &from, const Sidecar &sidecar,
+                  const std::uint64_t offset, const std::uint64_t nbytes,
+                  Data &to) {
+    using namespace std::literals;
+
+    to.resize(nbytes);
+    if (nbytes == 0) {
+        return;
+    }
+    if (offset + nbytes > sidecar.length) {
+        throw std::runtime_error("read beyond the checksummed length");
+    }
+
+    const std::uint64_t first_block = offset / kBlockSize;
+    const std::uint64_t last_block = NumBlocks(offset + nbytes);
+    const std::uint64_t begin = first_block * kBlockSize;
+    const std::uint64_t end =
+        std::min(sidecar.length, last_block * kBlockSize);
+
+    std::vector<char> blocks(end - begin);
+    from.seekg(begin, std::ios::beg);
+    from.read(blocks.data(), blocks.size());
+    if (!from) {
+        throw std::runtime_error("cannot read checksummed blocks");
+    }
+
+    const std::vector<std::uint64_t> bad =
+        VerifyBlocks(blocks.data(), sidecar, first_block, last_block);
+    if (!bad.empty()) {
+        throw std::runtime_error(
+            "checksum mismatch in block "s + std::to_string(bad.front()) +
+            " (bytes " + std::to_string(bad.front() * kBlockSize) + " to " +
+            std::to_string(
+                std::min(sidecar.length, (bad.front() + 1) * kBlockSize)) +
+            ")");
+    }
+
+    std::memcpy(to.data(), blocks.data() + (offset - begin), nbytes);
+}
+
+}  // namespace hyperlink::checksum
@@ -1,33 +1,151 @@
+#include <algorithm>
 #include <cstdint>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <string>
+#include <utility>
+#include <vector>
 
+#include "flags.h"
+#include "parallel.h"
+#include "report.h"
 #include "toker.h"
 
 using namespace hyperlink;
 
 using NodeID = std::uint64_t;
+using Edge = std::pair<NodeID, NodeID>;
 
-int main(const int argc, const char *argv[]) {
-    if (argc < 2) {
-        std::cerr << "usage: ./countstxtdups <input.txt>\n";
-        std::exit(1);
+// Size of the chunks that are scanned in parallel; chunk boundaries are moved
+// to the next line break.
+constexpr std::uint64_t kChunkSize = 64 * 1024 * 1024;
+
+struct Chunk {
+    std::size_t file;
+    std::uint64_t begin;
+    std::uint64_t end;
+};
+
+// Statistics of one chunk; multi-edges and sortedness across chunk boundaries
+// are checked when the chunks are stitched together.
+struct ChunkResult {
+    std::uint64_t edges = 0;
+    std::uint64_t self_loops = 0;
+    std::uint64_t multi_edges = 0;
+    std::uint64_t forward_edges = 0;
+    std::uint64_t backward_edges = 0;
+
+    Edge first_edge = {0, 0};
+    Edge last_edge = {0, 0};
+
+    // Number of the first unsorted edge within the chunk, counted from 1, or 0
+    // if the chunk is sorted; scanning stops at that edge, which is stored in
+    // unsorted_current while last_edge holds its predecessor
+    std::uint64_t unsorted_edge = 0;
+    Edge unsorted_current = {0, 0};
+};
+
+// Moves a chunk boundary to the start of the next line, unless it is already
+// at the start of a line.
+std::uint64_t AlignToLine(MappedFileToker &toker, const std::uint64_t pos) {
+    if (pos == 0 || pos >= toker.Length()) {
+        return std::min<std::uint64_t>(pos, toker.Length());
     }
 
-    const std::string input_filename = argv[1];
+    toker.Seek(pos - 1);
+    toker.SkipLine();
+    return toker.Position();
+}
+
+ChunkResult ScanChunk(const std::string &filename, const Chunk &chunk) {
+    MappedFileToker toker(filename);
+    const std::uint64_t begin = AlignToLine(toker, chunk.begin);
+    const std::uint64_t end = AlignToLine(toker, chunk.end);
+    toker.Seek(begin);
+    toker.Limit(end);
+    toker.SkipSpaces();
+
+    ChunkResult result;
+    Edge prev = {0, 0};
+
+    while (toker.ValidPosition()) {
+        const NodeID u = static_cast<NodeID>(toker.ScanUInt());
+        const NodeID v = static_cast<NodeID>(toker.ScanUInt());
+        const Edge edge = {u, v};
+
+        if (result.edges == 0) {
+            result.first_edge = edge;
+        } else if (edge < prev) {
+            result.unsorted_edge = result.edges + 1;
+            result.unsorted_current = edge;
+            result.last_edge = prev;
+            return result;
+        }
+
+        result.multi_edges += (result.edges > 0 && prev == edge);
+        result.self_loops += (u == v);
+        result.forward_edges += (u < v);
+        result.backward_edges += (u > v);
+        ++result.edges;
+
+        prev = edge;
+    }
 
-    if (std::ifstream in(input_filename); !in) {
-        std::cerr << "error: could not open input file\n";
+    result.last_edge = prev;
+    return result;
+}
+
+int main(int argc, const char *argv[]) {
+    report::Init(argc, argv);
+
+    if (argc < 2) {
+        std::cerr << "usage: ./countstxtdups <input.txt or glob>...\n";
         std::exit(1);
     }
 
-    MappedFileToker toker(input_filename);
+    // The input files are treated as if they were concatenated
+    std::vector<std::string> input_filenames;
+    for (int i = 1; i < argc; ++i) {
+        for (const std::string &input_filename : ExpandGlob(argv[i])) {
+            input_filenames.push_back(input_filename);
+        }
+    }
 
-    toker.SkipSpaces();
+    std::vector<Chunk> chunks;
+    for (std::size_t f = 0; f < input_filenames.size(); ++f) {
+        if (std::ifstream in(input_filenames[f]); !in) {
+            std::cerr << "error: could not open input file "
+                      << input_filenames[f] << "\n";
+            std::exit(1);
+        }
 
-    NodeID prev_u = 0;
-    NodeID prev_v = 0;
+        const std::uint64_t size =
+            std::filesystem::file_size(input_filenames[f]);
+        for (std::uint64_t begin = 0; begin < size; begin += kChunkSize) {
+            chunks.push_back({
+                .file = f,
+                .begin = begin,
+                .end = std::min(size, begin + kChunkSize),
+            });
+        }
+        report::AddBytesRead(size);
+    }
+
+    std::vector<ChunkResult> results(chunks.size());
+    {
+        report::ScopedPhase phase("scan");
+        auto scan_chunks = [&](int, const std::uint64_t first,
+                               const std::uint64_t last) {
+            for (std::uint64_t c = first; c < last; ++c) {
+                results[c] =
+                    ScanChunk(input_filenames[chunks[c].file], chunks[c]);
+            }
+        };
+        ParallelFor(0, chunks.size(), 1, scan_chunks);
+    }
+
+    Edge prev = {0, 0};
 
     std::uint64_t self_loops = 0;
     std::uint64_t multi_edges = 0;
@@ -35,26 +153,41 @@ int main(const int argc, const char *argv[]) {
     std::uint64_t forward_edge = 0;
     std::uint64_t backward_edge = 0;
 
-    while (toker.ValidPosition()) {
-        const NodeID u = static_cast<NodeID>(toker.ScanUInt());
-        const NodeID v = static_cast<NodeID>(toker.ScanUInt());
-
-        multi_edges += (lineno > 0 && prev_u == u && prev_v == v);
-        self_loops += (u == v);
-        forward_edge += (u < v);
-        backward_edge += (u > v);
-        ++lineno;
+    for (std::size_t c = 0; c < chunks.size(); ++c) {
+        const ChunkResult &result = results[c];
+        const std::string &input_filename = input_filenames[chunks[c].file];
 
-        if (prev_u > u || (prev_u == u && prev_v > v)) {
-            std::cerr << "Error in line " << lineno << ": not sorted\n";
-            std::cerr << "Previous edge: " << prev_u << "\t" << prev_v << "\n";
-            std::cerr << "Current edge:  " << u << "\t" << v << "\n";
+        auto report_unsorted = [&](const std::uint64_t line, const Edge &a,
+                                   const Edge &b) {
+            std::cerr << "Error in line " << line << " (" << input_filename
+                      << "): not sorted\n";
+            std::cerr << "Previous edge: " << a.first << "\t" << a.second
+                      << "\n";
+            std::cerr << "Current edge:  " << b.first << "\t" << b.second
+                      << "\n";
             std::exit(1);
+        };
+
+        if (result.edges == 0) {
+            continue;
+        }
+        if (result.first_edge < prev) {
+            report_unsorted(lineno + 1, prev, result.first_edge);
+        }
+        if (result.unsorted_edge > 0) {
+            report_unsorted(lineno + result.unsorted_edge, result.last_edge,
+                            result.unsorted_current);
         }
 
-        prev_u = u;
-        prev_v = v;
+        multi_edges +=
+            result.multi_edges + (lineno > 0 && prev == result.first_edge);
+        self_loops += result.self_loops;
+        forward_edge += result.forward_edges;
+        backward_edge += result.backward_edges;
+        lineno += result.edges;
+        prev = result.last_edge;
     }
+    report::AddEdges(lineno);
 
     std::cout << "Edges:       " << lineno << "\n";
     std::cout << "Multi-edges: " << multi_edges << "\n";
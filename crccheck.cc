@@ -0,0 +1,82 @@
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "checksum.h"
+#include "io.h"
+#include "report.h"
+
+using namespace hyperlink;
+
+// Maximum number of corrupted blocks listed per file.
+constexpr std::size_t kMaxListedBlocks = 16;
+
+// Returns true if the file matches its checksums.
+bool Check(const std::string &filename) {
+    const checksum::Sidecar sidecar = checksum::ReadSidecar(filename);
+    const io::MappedFile file(filename);
+
+    std::cout << filename << ": " << sidecar.crcs.size() << " block(s) of "
+              << checksum::kBlockSize / 1024 << " KiB" << std::endl;
+    if (file.Length() != sidecar.length) {
+        std::cout << "\tFAILED: file has " << file.Length()
+                  << " bytes, but the checksums cover " << sidecar.length
+                  << " bytes" << std::endl;
+        return false;
+    }
+
+    const std::vector<std::uint64_t> bad =
+        checksum::VerifyBlocks(file.Data(), sidecar, 0, sidecar.crcs.size());
+    report::AddBytesRead(file.Length());
+    if (bad.empty()) {
+        std::cout << "\tOK" << std::endl;
+        return true;
+    }
+
+    std::cout << "\tFAILED: " << bad.size() << " corrupted block(s)"
+              << std::endl;
+    for (std::size_t i = 0; i < std::min(bad.size(), kMaxListedBlocks); ++i) {
+        const std::uint64_t begin = bad[i] * checksum::kBlockSize;
+        const std::uint64_t end =
+            std::min(sidecar.length, begin + checksum::kBlockSize);
+        std::cout << "\t\tBlock " << bad[i] << ": bytes " << begin << " to "
+                  << end << std::endl;
+    }
+    if (bad.size() > kMaxListedBlocks) {
+        std::cout << "\t\t..." << std::endl;
+    }
+    return false;
+}
+
+int main(int argc, const char *argv[]) {
+    report::Init(argc, argv);
+
+    if (argc < 2) {
+        std::cerr << "usage: ./crccheck <files...>\n";
+        std::cerr << "Checks every file against the block checksums in "
+                     "<file>.crc; exits with status 2 if a file is "
+                     "corrupted.\n";
+        std::exit(1);
+    }
+
+    bool intact = true;
+    {
+        report::ScopedPhase phase("verify");
+        for (int i = 1; i < argc; ++i) {
+            try {
+                intact &= Check(argv[i]);
+            } catch (const std::exception &e) {
+                std::cerr << "error: " << e.what() << "\n";
+                std::exit(1);
+            }
+        }
+    }
+
+    if (!intact) {
+        std::exit(2);
+    }
+    std::cout << "Done." << std::endl;
+}
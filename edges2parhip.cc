@@ -1,6 +1,8 @@
 #include <algorithm>
 #include <array>
 #include <cstdint>
+#include <exception>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <numeric>
@@ -8,9 +10,20 @@
 #include <utility>
 #include <vector>
 
+#include "checkpoint.h"
+#include "checksum.h"
+#include "flags.h"
+#include "io.h"
+#include "parallel.h"
+#include "rank_bitmap.h"
+#include "report.h"
+
+using namespace hyperlink;
+
 using NodeID = std::uint32_t;
 using ParhipID = unsigned long long;
 using Edge = std::pair<NodeID, NodeID>;
+using EdgeWeight = std::uint32_t;
 
 ParhipID BuildVersion(const bool has_vertex_weights,
                       const bool has_edge_weights,
@@ -27,9 +40,9 @@ ParhipID BuildVersion(const bool has_vertex_weights,
     const ParhipID vertex_id_width_bit =
         static_cast<ParhipID>(has_32bit_vertex_ids) << 3;
     const ParhipID vertex_weight_width_bit =
-        static_cast<ParhipID>(has_32bit_vertex_weights) << 3;
+        static_cast<ParhipID>(has_32bit_vertex_weights) << 4;
     const ParhipID edge_weight_width_bit =
-        static_cast<ParhipID>(has_32bit_edge_weights) << 4;
+        static_cast<ParhipID>(has_32bit_edge_weights) << 5;
 
     return vertex_weights_bit | edge_weights_bit | edge_id_width_bit |
            vertex_id_width_bit | vertex_weight_width_bit |
@@ -43,16 +56,30 @@ std::size_t file_size(std::ifstream &in) {
     return size;
 }
 
+// Merges two sorted edge files. If weight files are given, they are read in
+// lockstep and every edge is passed with its weight; otherwise, all weights
+// are 1.
 template <std::size_t buf_size = 1ull * 1024 * 1024>
 class Merger {
    public:
-    Merger(std::ifstream &in_a, std::ifstream &in_b)
+    Merger(std::ifstream &in_a, std::ifstream &in_b,
+           const std::array<std::size_t, 2> &curs = {0, 0},
+           const std::array<std::ifstream *, 2> &weight_ins = {nullptr,
+                                                               nullptr})
         : _ins{&in_a, &in_b},
+          _weight_ins{weight_ins},
           _sizes{file_size(in_a), file_size(in_b)},
-          _curs{0, 0},
+          _curs{curs},
           _bufs{std::vector<Edge>{}, std::vector<Edge>{}} {
         for (std::size_t B = 0; B < _bufs.size(); ++B) {
             _bufs[B].resize(buf_size);
+            _ins[B]->seekg(block_begin(B), std::ios::beg);
+            if (_weight_ins[B] != nullptr) {
+                _weight_bufs[B].resize(buf_size);
+                _weight_ins[B]->seekg(
+                    block_begin(B) / sizeof(Edge) * sizeof(EdgeWeight),
+                    std::ios::beg);
+            }
             refill(B);
         }
     }
@@ -64,24 +91,38 @@ class Merger {
 
         while ((has_a = get(0, a)) | (has_b = get(1, b))) {
             if (!has_b || (has_a && a < b)) {
-                l(a);
+                l(a, weight(0));
                 advance(0);
             } else {
-                l(b);
+                l(b, weight(1));
                 advance(1);
             }
         }
     }
 
+    // Byte offsets of the next edge in each input file.
+    [[nodiscard]] const std::array<std::size_t, 2> &cursors() const {
+        return _curs;
+    }
+
    private:
+    std::size_t block_begin(const std::size_t B) const {
+        return _curs[B] - _curs[B] % (buf_size * sizeof(Edge));
+    }
+
     bool refill(const std::size_t B) {
         if (_curs[B] == _sizes[B]) {
             return false;
         }
 
         const std::size_t N =
-            std::min(buf_size * sizeof(Edge), _sizes[B] - _curs[B]);
+            std::min(buf_size * sizeof(Edge), _sizes[B] - block_begin(B));
         _ins[B]->read(reinterpret_cast<char *>(_bufs[B].data()), N);
+        if (_weight_ins[B] != nullptr) {
+            _weight_ins[B]->read(
+                reinterpret_cast<char *>(_weight_bufs[B].data()),
+                N / sizeof(Edge) * sizeof(EdgeWeight));
+        }
         return true;
     }
 
@@ -94,6 +135,13 @@ class Merger {
         return true;
     }
 
+    EdgeWeight weight(const std::size_t B) const {
+        if (_weight_ins[B] == nullptr) {
+            return 1;
+        }
+        return _weight_bufs[B][(_curs[B] / sizeof(Edge)) % buf_size];
+    }
+
     void advance(const std::size_t B) {
         _curs[B] += sizeof(Edge);
         if ((_curs[B] % (buf_size * sizeof(Edge))) == 0) {
@@ -102,15 +150,32 @@ class Merger {
     }
 
     std::array<std::ifstream *, 2> _ins;
+    std::array<std::ifstream *, 2> _weight_ins;
     std::array<std::size_t, 2> _sizes;
     std::array<std::size_t, 2> _curs;
     std::array<std::vector<Edge>, 2> _bufs;
+    std::array<std::vector<EdgeWeight>, 2> _weight_bufs;
 };
 
-int main(const int argc, const char *argv[]) {
+// Number of adjncy[] buffers written between two checkpoints.
+constexpr std::size_t kCheckpointInterval = 256;
+
+int main(int argc, const char *argv[]) {
+    report::Init(argc, argv);
+    const std::string checkpoint_directory =
+        ExtractFlag(argc, argv, "checkpoint");
+    const std::string mapping_filename = ExtractFlag(argc, argv, "compact");
+    const bool compact = !mapping_filename.empty();
+    const bool weighted = ExtractSwitch(argc, argv, "weights");
+
     if (argc != 4) {
-        std::cerr << "usage: ./edges2parhip <input.bin> <input.rev.bin> "
-                     "<output.parhip>\n";
+        std::cerr << "usage: ./edges2parhip [--checkpoint=<directory>] "
+                     "[--compact=<mapping.bin>] [--weights] <input.bin> "
+                     "<input.rev.bin> <output.parhip>\n";
+        std::cerr << "With --compact, unused vertex IDs are dropped and "
+                     "mapping.bin stores the old ID of every vertex.\n";
+        std::cerr << "With --weights, edge weights are read from "
+                     "<input>.weights as written by txt2sbin --weights.\n";
         std::exit(1);
     }
 
@@ -118,7 +183,26 @@ int main(const int argc, const char *argv[]) {
     const std::string input_b_filename = argv[2];
     const std::string output_filename = argv[3];
 
-    if (std::ifstream test_out(output_filename, std::ios::binary); test_out) {
+    checkpoint::Checkpoint checkpoint;
+    if (!checkpoint_directory.empty()) {
+        std::string options = output_filename;
+        if (compact) {
+            options += "|compact=" + mapping_filename;
+        }
+        if (weighted) {
+            options += "|weights";
+        }
+        checkpoint = checkpoint::Checkpoint(
+            checkpoint_directory,
+            checkpoint::Fingerprint({input_a_filename, input_b_filename},
+                                    options));
+    }
+
+    // Stages: 1 = xadj[] was computed, 2 = header and xadj[] were written
+    const std::uint64_t stage = checkpoint.Get("stage");
+
+    if (std::ifstream test_out(output_filename, std::ios::binary);
+        test_out && stage < 2) {
         std::cerr << "error: output file already exists\n";
         std::exit(1);
     }
@@ -140,76 +224,288 @@ int main(const int argc, const char *argv[]) {
         //std::exit(1);
     //}
 
-    std::ofstream out(output_filename, std::ios::binary | std::ios_base::trunc);
+    std::ifstream weights_a;
+    std::ifstream weights_b;
+    std::array<std::ifstream *, 2> weight_ins = {nullptr, nullptr};
+    if (weighted) {
+        weights_a.open(input_a_filename + ".weights", std::ios::binary);
+        weights_b.open(input_b_filename + ".weights", std::ios::binary);
+        if (!weights_a || !weights_b ||
+            file_size(weights_a) / sizeof(EdgeWeight) !=
+                file_size(in_a) / sizeof(Edge) ||
+            file_size(weights_b) / sizeof(EdgeWeight) !=
+                file_size(in_b) / sizeof(Edge)) {
+            std::cerr << "error: weight files are missing or do not match "
+                         "the input files\n";
+            std::exit(1);
+        }
+        weight_ins = {&weights_a, &weights_b};
+    }
+
+    // With --compact, every vertex ID is replaced by its rank among the IDs
+    // that occur in the input, i.e., unused IDs do not become isolated vertices
+    RankBitmap used_ids;
+    if (compact) {
+        std::cout << "Marking used vertex IDs ..." << std::endl;
+        report::ScopedPhase phase("mark_ids");
+        used_ids = MarkUsedIDs<NodeID>({input_a_filename, input_b_filename});
+        std::cout << "\t" << used_ids.Count() << " of " << used_ids.Size()
+                  << " IDs are used" << std::endl;
+    }
+    auto relabel = [&](const NodeID u) -> NodeID {
+        return compact ? static_cast<NodeID>(used_ids.Rank(u)) : u;
+    };
 
     std::vector<ParhipID> xadj;
+    ParhipID n = checkpoint.Get("n");
+    ParhipID m = checkpoint.Get("m");
+
+    if (stage >= 1) {
+        std::cout << "Reading xadj[] from checkpoint ..." << std::endl;
+        xadj.resize(n + 1);
+
+        std::ifstream in(checkpoint.Path("xadj"), std::ios::binary);
+        in.read(reinterpret_cast<char *>(xadj.data()),
+                xadj.size() * sizeof(ParhipID));
+        if (!in) {
+            std::cerr << "error: checkpointed xadj[] is truncated, remove the "
+                         "checkpoint to start over\n";
+            std::exit(1);
+        }
+    } else {
+        std::cout << "Counting degrees ..." << std::endl;
+
+        // First pass for xadj
+        {
+            report::ScopedPhase phase("count_degrees");
+            Merger<> merger(in_a, in_b);
+            merger.for_each_edge([&](const Edge &edge, EdgeWeight) {
+                const NodeID u = relabel(edge.first);
+                while (xadj.size() <= u) {
+                    xadj.push_back(0);
+                    if (xadj.size() % (1ull * 1024 * 1024) == 0) {
+                        std::cout << "\t" << xadj.size() << " nodes, " << u
+                                  << " ..." << std::endl;
+                    }
+                }
+                ++xadj[u];
+            });
+            if (compact) {
+                // The last vertices might only occur as neighbors
+                xadj.resize(used_ids.Count());
+            }
 
-    std::cout << "Counting degrees ..." << std::endl;
+            const ParhipID num_edges =
+                std::accumulate(xadj.begin(), xadj.end(), ParhipID{0});
+            report::AddBytesRead(num_edges * sizeof(Edge));
+            report::AddEdges(num_edges);
+        }
 
-    // First pass for xadj
-    {
-        Merger<> merger(in_a, in_b);
-        merger.for_each_edge([&](const Edge &edge) {
-            const auto &[u, v] = edge;
-            while (xadj.size() <= u) {
-                xadj.push_back(0);
-                if (xadj.size() % (1ull * 1024 * 1024) == 0) {
-                    std::cout << "\t" << xadj.size() << " nodes, " << u
-                              << " ..." << std::endl;
-                }
+        if (compact) {
+            std::cout << "Writing vertex ID mapping ..." << std::endl;
+            report::ScopedPhase phase("write_mapping");
+
+            std::vector<NodeID> mapping;
+            mapping.reserve(used_ids.Count());
+            used_ids.ForEachSetBit(
+                [&](const std::uint64_t id) { mapping.push_back(id); });
+
+            std::ofstream out(mapping_filename,
+                              std::ios::binary | std::ios::trunc);
+            out.write(reinterpret_cast<const char *>(mapping.data()),
+                      mapping.size() * sizeof(NodeID));
+            if (!out) {
+                std::cerr << "error: cannot write to " << mapping_filename
+                          << "\n";
+                std::exit(1);
             }
-            ++xadj[u];
-        });
-    }
+            report::AddBytesWritten(mapping.size() * sizeof(NodeID));
+        }
+
+        std::cout << "Computing prefix sum for xadj[] ..." << std::endl;
+
+        n = xadj.size();
+        xadj.push_back(0);
+        std::exclusive_scan(xadj.begin(), xadj.end(), xadj.begin(),
+                            static_cast<ParhipID>(0));
+        m = xadj.back();
+
+        std::cout << "Adding offsets to xadj[] ..." << std::endl;
+
+        for (ParhipID &x : xadj) {
+            x = 3 * sizeof(ParhipID) + (n + 1) * sizeof(ParhipID) +
+                x * sizeof(NodeID);
+        }
 
-    std::cout << "Computing prefix sum for xadj[] ..." << std::endl;
+        if (checkpoint.Enabled()) {
+            std::ofstream out(checkpoint.Path("xadj"),
+                              std::ios::binary | std::ios::trunc);
+            out.write(reinterpret_cast<const char *>(xadj.data()),
+                      xadj.size() * sizeof(ParhipID));
+            out.flush();
 
-    const ParhipID n = xadj.size();
-    xadj.push_back(0);
-    std::exclusive_scan(xadj.begin(), xadj.end(), xadj.begin(), static_cast<ParhipID>(0));
-    const ParhipID m = xadj.back();
+            checkpoint.Set("stage", 1);
+            checkpoint.Set("n", n);
+            checkpoint.Set("m", m);
+
+            std::vector<std::string> data_filenames = {checkpoint.Path("xadj")};
+            if (compact) {
+                data_filenames.push_back(mapping_filename);
+            }
+            checkpoint.Commit(data_filenames);
+        }
+    }
 
     std::cout << "There are " << n << " nodes and " << m << " edges"
               << std::endl;
-    std::cout << "Adding offsets to xadj[] ..." << std::endl;
 
-    for (ParhipID &x : xadj) {
-        x = 3 * sizeof(ParhipID) + (n + 1) * sizeof(ParhipID) +
-            x * sizeof(NodeID);
-    }
+    // The edge weights follow adjncy[] and are written through a second
+    // stream in lockstep with it
+    const ParhipID adjncy_offset = xadj.front();
+    const ParhipID weights_offset = adjncy_offset + m * sizeof(NodeID);
+    ParhipID adjncy_written = checkpoint.Get("adjncy_written");
+    std::fstream out;
+    std::fstream weights_out;
+
+    // Checksums are computed while writing; only data that is already on
+    // disk (after resuming, or the edge weights, which are written out of
+    // order) is read back
+    checksum::StreamChecksums checksums;
+
+    if (stage >= 2) {
+        std::cout << "Resuming after " << adjncy_written
+                  << " edges of adjncy[] ..." << std::endl;
+
+        const ParhipID size =
+            weighted ? weights_offset + adjncy_written * sizeof(EdgeWeight)
+                     : adjncy_offset + adjncy_written * sizeof(NodeID);
+        if (!std::filesystem::exists(output_filename) ||
+            std::filesystem::file_size(output_filename) < size) {
+            std::cerr << "error: output file is truncated, remove the "
+                         "checkpoint to start over\n";
+            std::exit(1);
+        }
+        std::filesystem::resize_file(output_filename, size);
+        try {
+            checksums.AppendFromFile(output_filename,
+                                     adjncy_offset +
+                                         adjncy_written * sizeof(NodeID));
+        } catch (const std::exception &e) {
+            std::cerr << "error: " << e.what() << "\n";
+            std::exit(1);
+        }
 
-    std::cout << "Writing xadj[] to output file ..." << std::endl;
+        out.open(output_filename,
+                 std::ios::binary | std::ios::in | std::ios::out);
+        out.seekp(adjncy_offset + adjncy_written * sizeof(NodeID));
+    } else {
+        out.open(output_filename, std::ios::binary | std::ios::out |
+                                      std::ios::trunc);
+
+        std::cout << "Writing xadj[] to output file ..." << std::endl;
+        report::ScopedPhase phase("write_xadj");
+
+        const ParhipID version =
+            BuildVersion(false, weighted, false, true, false, weighted);
+        const std::array<ParhipID, 3> header = {version, n, m};
+        out.write(reinterpret_cast<const char *>(header.data()),
+                  sizeof(header));
+        out.write(reinterpret_cast<const char *>(xadj.data()),
+                  xadj.size() * sizeof(ParhipID));
+        checksums.Append(header.data(), sizeof(header));
+        checksums.Append(xadj.data(), xadj.size() * sizeof(ParhipID));
+        report::AddBytesWritten((3 + xadj.size()) * sizeof(ParhipID));
+        out.flush();
+
+        if (checkpoint.Enabled()) {
+            checkpoint.Set("stage", 2);
+            checkpoint.Set("adjncy_written", 0);
+            checkpoint.Commit({output_filename});
+        }
+    }
 
-    const ParhipID version =
-        BuildVersion(false, false, false, true, false, false);
-    out.write(reinterpret_cast<const char *>(&version), sizeof(ParhipID));
-    out.write(reinterpret_cast<const char *>(&n), sizeof(ParhipID));
-    out.write(reinterpret_cast<const char *>(&m), sizeof(ParhipID));
-    out.write(reinterpret_cast<const char *>(xadj.data()),
-              xadj.size() * sizeof(ParhipID));
+    if (weighted) {
+        weights_out.open(output_filename,
+                         std::ios::binary | std::ios::in | std::ios::out);
+        weights_out.seekp(weights_offset +
+                          adjncy_written * sizeof(EdgeWeight));
+    }
 
     constexpr std::size_t buf_size = 1ull * 1 * 1024 * 1024;
     std::vector<NodeID> adjncy;
+    std::vector<EdgeWeight> weights;
     adjncy.reserve(buf_size);
+    weights.reserve(weighted ? buf_size : 0);
+
+    auto flush = [&] {
+        out.write(reinterpret_cast<const char *>(adjncy.data()),
+                  adjncy.size() * sizeof(NodeID));
+        checksums.Append(adjncy.data(), adjncy.size() * sizeof(NodeID));
+        weights_out.write(reinterpret_cast<const char *>(weights.data()),
+                          weights.size() * sizeof(EdgeWeight));
+        adjncy_written += adjncy.size();
+        adjncy.clear();
+        weights.clear();
+    };
 
     std::cout << "Reading and writing adjncy[] ..." << std::endl;
 
     // Second pass for adjncy
     {
-        Merger<> merger(in_a, in_b);
-        merger.for_each_edge([&](const Edge &edge) {
-            adjncy.push_back(edge.second);
+        report::ScopedPhase phase("write_adjncy");
+        Merger<> merger(
+            in_a, in_b,
+            {checkpoint.Get("cursor_a"), checkpoint.Get("cursor_b")},
+            weight_ins);
+
+        // The buffer is flushed lazily before the next edge is added, i.e.,
+        // the cursors of the merger point to the first unwritten edge
+        std::size_t num_flushes = 0;
+        merger.for_each_edge([&](const Edge &edge, const EdgeWeight weight) {
             if (adjncy.size() == buf_size) {
-                out.write(reinterpret_cast<const char *>(adjncy.data()),
-                          adjncy.size() * sizeof(NodeID));
-                adjncy.clear();
+                flush();
+
+                if (checkpoint.Enabled() &&
+                    ++num_flushes % kCheckpointInterval == 0) {
+                    out.flush();
+                    weights_out.flush();
+                    checkpoint.Set("adjncy_written", adjncy_written);
+                    checkpoint.Set("cursor_a", merger.cursors()[0]);
+                    checkpoint.Set("cursor_b", merger.cursors()[1]);
+                    checkpoint.Commit({output_filename});
+                }
+            }
+            adjncy.push_back(relabel(edge.second));
+            if (weighted) {
+                weights.push_back(weight);
             }
         });
-        if (!adjncy.empty()) {
-            out.write(reinterpret_cast<const char *>(adjncy.data()),
-                      adjncy.size() * sizeof(NodeID));
-        }
+        flush();
+
+        const ParhipID weight_bytes = weighted ? m * sizeof(EdgeWeight) : 0;
+        report::AddBytesRead(m * sizeof(Edge) + weight_bytes);
+        report::AddBytesWritten(m * sizeof(NodeID) + weight_bytes);
+        report::AddEdges(m);
+    }
+
+    out.close();
+    weights_out.close();
+    if (!out || (weighted && !weights_out)) {
+        std::cerr << "error: cannot write to " << output_filename << "\n";
+        std::exit(1);
+    }
+
+    try {
+        checksums.AppendFromFile(output_filename,
+                                 weighted ? weights_offset +
+                                                m * sizeof(EdgeWeight)
+                                          : weights_offset);
+        checksums.Write(output_filename);
+    } catch (const std::exception &e) {
+        std::cerr << "error: " << e.what() << "\n";
+        std::exit(1);
     }
+    checkpoint.Remove();
 
     std::cout << "Done." << std::endl;
 }
@@ -1,5 +1,8 @@
 #include <algorithm>
+#include <array>
 #include <cstdint>
+#include <exception>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <numeric>
@@ -7,6 +10,16 @@
 #include <utility>
 #include <vector>
 
+#include "checkpoint.h"
+#include "checksum.h"
+#include "flags.h"
+#include "io.h"
+#include "parallel.h"
+#include "rank_bitmap.h"
+#include "report.h"
+
+using namespace hyperlink;
+
 using NodeID = std::uint64_t;
 using ParhipID = unsigned long long;
 using Edge = std::pair<NodeID, NodeID>;
@@ -26,9 +39,9 @@ ParhipID BuildVersion(const bool has_vertex_weights,
     const ParhipID vertex_id_width_bit =
         static_cast<ParhipID>(has_32bit_vertex_ids) << 3;
     const ParhipID vertex_weight_width_bit =
-        static_cast<ParhipID>(has_32bit_vertex_weights) << 3;
+        static_cast<ParhipID>(has_32bit_vertex_weights) << 4;
     const ParhipID edge_weight_width_bit =
-        static_cast<ParhipID>(has_32bit_edge_weights) << 4;
+        static_cast<ParhipID>(has_32bit_edge_weights) << 5;
 
     return vertex_weights_bit | edge_weights_bit | edge_id_width_bit |
            vertex_id_width_bit | vertex_weight_width_bit |
@@ -45,13 +58,17 @@ std::size_t file_size(std::ifstream &in) {
 template <std::size_t buf_size = 1ull * 1024 * 1024>
 class Merger {
    public:
-    Merger(std::vector<std::ifstream> &ins) : _ins(ins), _B(_ins.size()) {
+    Merger(std::vector<std::ifstream> &ins,
+           const std::vector<std::size_t> &curs = {})
+        : _ins(ins), _B(_ins.size()) {
         for (auto &in : _ins) {
+            const std::size_t b = _bufs.size();
             _sizes.push_back(file_size(in));
-            _curs.push_back(0);
+            _curs.push_back(curs.empty() ? 0 : curs[b]);
 
             _bufs.emplace_back(buf_size);
-            refill(_bufs.size() - 1);
+            in.seekg(block_begin(b), std::ios::beg);
+            refill(b);
         }
     }
 
@@ -84,14 +101,23 @@ class Merger {
         }
     }
 
+    // Byte offsets of the next edge in each input file.
+    [[nodiscard]] const std::vector<std::size_t> &cursors() const {
+        return _curs;
+    }
+
    private:
+    std::size_t block_begin(const std::size_t b) const {
+        return _curs[b] - _curs[b] % (buf_size * sizeof(Edge));
+    }
+
     bool refill(const std::size_t b) {
         if (_curs[b] == _sizes[b]) {
             return false;
         }
 
         const std::size_t N =
-            std::min(buf_size * sizeof(Edge), _sizes[b] - _curs[b]);
+            std::min(buf_size * sizeof(Edge), _sizes[b] - block_begin(b));
         _ins[b].read(reinterpret_cast<char *>(_bufs[b].data()), N);
         return true;
     }
@@ -120,76 +146,228 @@ class Merger {
     std::vector<std::vector<Edge>> _bufs = {};
 };
 
-int main(const int argc, const char *argv[]) {
+// Number of adjncy[] buffers written between two checkpoints.
+constexpr std::size_t kCheckpointInterval = 256;
+
+int main(int argc, const char *argv[]) {
+    report::Init(argc, argv);
+    const std::string checkpoint_directory =
+        ExtractFlag(argc, argv, "checkpoint");
+    const std::string mapping_filename = ExtractFlag(argc, argv, "compact");
+    const bool compact = !mapping_filename.empty();
+
     if (argc < 3) {
-        std::cerr << "usage: ./edges2parhip <output.parhip> <inputs...>\n";
+        std::cerr << "usage: ./edges2parhip [--checkpoint=<directory>] "
+                     "[--compact=<mapping.bin>] <output.parhip> <inputs...>\n";
+        std::cerr << "With --compact, unused vertex IDs are dropped and "
+                     "mapping.bin stores the old ID of every vertex.\n";
         std::exit(1);
     }
 
     const std::string output_filename = argv[1];
+    const std::vector<std::string> input_filenames(argv + 2, argv + argc);
 
     std::vector<std::ifstream> ins;
-    for (std::size_t b = 2; b < argc; ++b) {
-        ins.emplace_back(argv[b], std::ios::binary);
+    for (const std::string &input_filename : input_filenames) {
+        ins.emplace_back(input_filename, std::ios::binary);
         if (!ins.back()) {
-            std::cerr << "error: cannot read input buffer " << argv[b] << "\n";
+            std::cerr << "error: cannot read input buffer " << input_filename
+                      << "\n";
             std::exit(1);
         }
     }
 
-    std::ofstream out(output_filename, std::ios::binary | std::ios_base::trunc);
-    if (!out) {
-        std::cerr << "error: cannot write to output buffer " << output_filename
-                  << "\n";
-        std::exit(1);
+    checkpoint::Checkpoint checkpoint;
+    if (!checkpoint_directory.empty()) {
+        checkpoint = checkpoint::Checkpoint(
+            checkpoint_directory,
+            checkpoint::Fingerprint(
+                input_filenames,
+                compact ? output_filename + "|compact=" + mapping_filename
+                        : output_filename));
+    }
+
+    // Stages: 1 = xadj[] was computed, 2 = header and xadj[] were written
+    const std::uint64_t stage = checkpoint.Get("stage");
+
+    // With --compact, every vertex ID is replaced by its rank among the IDs
+    // that occur in the input, i.e., unused IDs do not become isolated vertices
+    RankBitmap used_ids;
+    if (compact) {
+        std::cout << "Marking used vertex IDs ..." << std::endl;
+        report::ScopedPhase phase("mark_ids");
+        used_ids = MarkUsedIDs<NodeID>(input_filenames);
+        std::cout << "\t" << used_ids.Count() << " of " << used_ids.Size()
+                  << " IDs are used" << std::endl;
     }
+    auto relabel = [&](const NodeID u) -> NodeID {
+        return compact ? static_cast<NodeID>(used_ids.Rank(u)) : u;
+    };
 
     std::vector<ParhipID> xadj;
+    ParhipID n = checkpoint.Get("n");
+    ParhipID m = checkpoint.Get("m");
+
+    if (stage >= 1) {
+        std::cout << "Reading xadj[] from checkpoint ..." << std::endl;
+        xadj.resize(n + 1);
+
+        std::ifstream in(checkpoint.Path("xadj"), std::ios::binary);
+        in.read(reinterpret_cast<char *>(xadj.data()),
+                xadj.size() * sizeof(ParhipID));
+        if (!in) {
+            std::cerr << "error: checkpointed xadj[] is truncated, remove the "
+                         "checkpoint to start over\n";
+            std::exit(1);
+        }
+    } else {
+        std::cout << "Counting degrees ..." << std::endl;
+
+        // First pass for xadj
+        {
+            report::ScopedPhase phase("count_degrees");
+            Merger<> merger(ins);
+            merger.for_each_edge([&](const Edge &edge) {
+                const NodeID u = relabel(edge.first);
+                while (xadj.size() <= u) {
+                    xadj.push_back(0);
+                    if (xadj.size() % (1ull * 1024 * 1024 * 1024) == 0) {
+                        std::cout << "\t" << xadj.size() << " nodes ..."
+                                  << std::endl;
+                    }
+                }
+                ++xadj[u];
+            });
+            if (compact) {
+                // The last vertices might only occur as neighbors
+                xadj.resize(used_ids.Count());
+            }
 
-    std::cout << "Counting degrees ..." << std::endl;
+            const ParhipID num_edges =
+                std::accumulate(xadj.begin(), xadj.end(), ParhipID{0});
+            report::AddBytesRead(num_edges * sizeof(Edge));
+            report::AddEdges(num_edges);
+        }
 
-    // First pass for xadj
-    {
-        Merger<> merger(ins);
-        merger.for_each_edge([&](const Edge &edge) {
-            const auto &[u, v] = edge;
-            while (xadj.size() <= u) {
-                xadj.push_back(0);
-                if (xadj.size() % (1ull * 1024 * 1024 * 1024) == 0) {
-                    std::cout << "\t" << xadj.size() << " nodes ..."
-                              << std::endl;
-                }
+        if (compact) {
+            std::cout << "Writing vertex ID mapping ..." << std::endl;
+            report::ScopedPhase phase("write_mapping");
+
+            std::vector<NodeID> mapping;
+            mapping.reserve(used_ids.Count());
+            used_ids.ForEachSetBit(
+                [&](const std::uint64_t id) { mapping.push_back(id); });
+
+            std::ofstream out(mapping_filename,
+                              std::ios::binary | std::ios::trunc);
+            out.write(reinterpret_cast<const char *>(mapping.data()),
+                      mapping.size() * sizeof(NodeID));
+            if (!out) {
+                std::cerr << "error: cannot write to " << mapping_filename
+                          << "\n";
+                std::exit(1);
             }
-            ++xadj[u];
-        });
-    }
+            report::AddBytesWritten(mapping.size() * sizeof(NodeID));
+        }
+
+        std::cout << "Computing prefix sum for xadj[] ..." << std::endl;
+
+        n = xadj.size();
+        xadj.push_back(0);
+        std::exclusive_scan(xadj.begin(), xadj.end(), xadj.begin(),
+                            static_cast<ParhipID>(0));
+        m = xadj.back();
+
+        std::cout << "Adding offsets to xadj[] ..." << std::endl;
+
+        for (ParhipID &x : xadj) {
+            x = 3 * sizeof(ParhipID) + (n + 1) * sizeof(ParhipID) +
+                x * sizeof(NodeID);
+        }
+
+        if (checkpoint.Enabled()) {
+            std::ofstream out(checkpoint.Path("xadj"),
+                              std::ios::binary | std::ios::trunc);
+            out.write(reinterpret_cast<const char *>(xadj.data()),
+                      xadj.size() * sizeof(ParhipID));
+            out.flush();
 
-    std::cout << "Computing prefix sum for xadj[] ..." << std::endl;
+            checkpoint.Set("stage", 1);
+            checkpoint.Set("n", n);
+            checkpoint.Set("m", m);
 
-    const ParhipID n = xadj.size();
-    xadj.push_back(0);
-    std::exclusive_scan(xadj.begin(), xadj.end(), xadj.begin(),
-                        static_cast<ParhipID>(0));
-    const ParhipID m = xadj.back();
+            std::vector<std::string> data_filenames = {checkpoint.Path("xadj")};
+            if (compact) {
+                data_filenames.push_back(mapping_filename);
+            }
+            checkpoint.Commit(data_filenames);
+        }
+    }
 
     std::cout << "There are " << n << " nodes and " << m << " edges"
               << std::endl;
-    std::cout << "Adding offsets to xadj[] ..." << std::endl;
 
-    for (ParhipID &x : xadj) {
-        x = 3 * sizeof(ParhipID) + (n + 1) * sizeof(ParhipID) +
-            x * sizeof(NodeID);
-    }
+    const ParhipID adjncy_offset = xadj.front();
+    ParhipID adjncy_written = checkpoint.Get("adjncy_written");
+    std::fstream out;
+
+    // Checksums are computed while writing; after resuming, the part that is
+    // already on disk is read back
+    checksum::StreamChecksums checksums;
+
+    if (stage >= 2) {
+        std::cout << "Resuming after " << adjncy_written
+                  << " edges of adjncy[] ..." << std::endl;
 
-    std::cout << "Writing xadj[] to output file ..." << std::endl;
+        const ParhipID size = adjncy_offset + adjncy_written * sizeof(NodeID);
+        if (!std::filesystem::exists(output_filename) ||
+            std::filesystem::file_size(output_filename) < size) {
+            std::cerr << "error: output file is truncated, remove the "
+                         "checkpoint to start over\n";
+            std::exit(1);
+        }
+        std::filesystem::resize_file(output_filename, size);
+        try {
+            checksums.AppendFromFile(output_filename, size);
+        } catch (const std::exception &e) {
+            std::cerr << "error: " << e.what() << "\n";
+            std::exit(1);
+        }
+
+        out.open(output_filename, std::ios::binary | std::ios::in |
+                                      std::ios::out | std::ios::ate);
+    } else {
+        out.open(output_filename, std::ios::binary | std::ios::out |
+                                      std::ios::trunc);
+    }
+    if (!out) {
+        std::cerr << "error: cannot write to output buffer " << output_filename
+                  << "\n";
+        std::exit(1);
+    }
 
-    const ParhipID version =
-        BuildVersion(false, false, false, sizeof(NodeID) == 4, false, false);
-    out.write(reinterpret_cast<const char *>(&version), sizeof(ParhipID));
-    out.write(reinterpret_cast<const char *>(&n), sizeof(ParhipID));
-    out.write(reinterpret_cast<const char *>(&m), sizeof(ParhipID));
-    out.write(reinterpret_cast<const char *>(xadj.data()),
-              xadj.size() * sizeof(ParhipID));
+    if (stage < 2) {
+        std::cout << "Writing xadj[] to output file ..." << std::endl;
+        report::ScopedPhase phase("write_xadj");
+
+        const ParhipID version = BuildVersion(false, false, false,
+                                              sizeof(NodeID) == 4, false, false);
+        const std::array<ParhipID, 3> header = {version, n, m};
+        out.write(reinterpret_cast<const char *>(header.data()),
+                  sizeof(header));
+        out.write(reinterpret_cast<const char *>(xadj.data()),
+                  xadj.size() * sizeof(ParhipID));
+        checksums.Append(header.data(), sizeof(header));
+        checksums.Append(xadj.data(), xadj.size() * sizeof(ParhipID));
+        report::AddBytesWritten((3 + xadj.size()) * sizeof(ParhipID));
+
+        if (checkpoint.Enabled()) {
+            out.flush();
+            checkpoint.Set("stage", 2);
+            checkpoint.Set("adjncy_written", 0);
+            checkpoint.Commit({output_filename});
+        }
+    }
 
     constexpr std::size_t buf_size = 1ull * 1 * 1024 * 1024;
     std::vector<NodeID> adjncy;
@@ -199,20 +377,59 @@ int main(const int argc, const char *argv[]) {
 
     // Second pass for adjncy
     {
-        Merger<> merger(ins);
+        report::ScopedPhase phase("write_adjncy");
+
+        std::vector<std::size_t> curs;
+        if (stage >= 2) {
+            for (std::size_t b = 0; b < ins.size(); ++b) {
+                curs.push_back(checkpoint.Get("cursor" + std::to_string(b)));
+            }
+        }
+        Merger<> merger(ins, curs);
+
+        // The buffer is flushed lazily before the next edge is added, i.e.,
+        // the cursors of the merger point to the first unwritten edge
+        std::size_t num_flushes = 0;
         merger.for_each_edge([&](const Edge &edge) {
-            adjncy.push_back(edge.second);
             if (adjncy.size() == buf_size) {
                 out.write(reinterpret_cast<const char *>(adjncy.data()),
                           adjncy.size() * sizeof(NodeID));
+                checksums.Append(adjncy.data(),
+                                 adjncy.size() * sizeof(NodeID));
+                adjncy_written += adjncy.size();
                 adjncy.clear();
+
+                if (checkpoint.Enabled() &&
+                    ++num_flushes % kCheckpointInterval == 0) {
+                    out.flush();
+                    checkpoint.Set("adjncy_written", adjncy_written);
+                    for (std::size_t b = 0; b < ins.size(); ++b) {
+                        checkpoint.Set("cursor" + std::to_string(b),
+                                       merger.cursors()[b]);
+                    }
+                    checkpoint.Commit({output_filename});
+                }
             }
+            adjncy.push_back(relabel(edge.second));
         });
         if (!adjncy.empty()) {
             out.write(reinterpret_cast<const char *>(adjncy.data()),
                       adjncy.size() * sizeof(NodeID));
+            checksums.Append(adjncy.data(), adjncy.size() * sizeof(NodeID));
         }
+        report::AddBytesRead(m * sizeof(Edge));
+        report::AddBytesWritten(m * sizeof(NodeID));
+        report::AddEdges(m);
+    }
+
+    out.close();
+    try {
+        checksums.Write(output_filename);
+    } catch (const std::exception &e) {
+        std::cerr << "error: " << e.what() << "\n";
+        std::exit(1);
     }
+    checkpoint.Remove();
 
     std::cout << "Done." << std::endl;
 }
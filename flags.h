@@ -0,0 +1,70 @@
+#pragma once
+
+#include <glob.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace hyperlink {
+
+// Removes --<name>=<value> or --<name> <value> from the command line and
+// returns the value; returns `fallback` if the flag is not present.
+inline std::string ExtractFlag(int &argc, const char *argv[],
+                               const std::string &name,
+                               const std::string &fallback = "") {
+    const std::string flag = "--" + name;
+    std::string value = fallback;
+
+    int dst = 1;
+    for (int src = 1; src < argc; ++src) {
+        if (std::strncmp(argv[src], flag.c_str(), flag.size()) == 0 &&
+            argv[src][flag.size()] == '=') {
+            value = argv[src] + flag.size() + 1;
+        } else if (flag == argv[src] && src + 1 < argc) {
+            value = argv[++src];
+        } else {
+            argv[dst++] = argv[src];
+        }
+    }
+    argc = dst;
+
+    return value;
+}
+
+// Removes --<name> from the command line and returns whether it was present.
+inline bool ExtractSwitch(int &argc, const char *argv[],
+                          const std::string &name) {
+    const std::string flag = "--" + name;
+    bool present = false;
+
+    int dst = 1;
+    for (int src = 1; src < argc; ++src) {
+        if (flag == argv[src]) {
+            present = true;
+        } else {
+            argv[dst++] = argv[src];
+        }
+    }
+    argc = dst;
+
+    return present;
+}
+
+// Expands a glob pattern such as "parts/*.txt" to the sorted list of matching
+// files. A pattern without matches is returned as is, so that opening it
+// reports the missing file.
+inline std::vector<std::string> ExpandGlob(const std::string &pattern) {
+    glob_t matches{};
+    if (glob(pattern.c_str(), 0, nullptr, &matches) != 0) {
+        globfree(&matches);
+        return {pattern};
+    }
+
+    std::vector<std::string> filenames(matches.gl_pathv,
+                                       matches.gl_pathv + matches.gl_pathc);
+    globfree(&matches);
+    return filenames;
+}
+
+}  // namespace hyperlink
@@ -0,0 +1,254 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "allocator.h"
+#include "parallel.h"
+
+namespace hyperlink::io {
+
+// Size of the blocks that are transferred by one thread at a time; a multiple
+// of the alignment required by O_DIRECT.
+constexpr std::size_t kBlockSize = 64 * 1024 * 1024;
+constexpr std::size_t kDirectAlignment = 4096;
+
+namespace internal {
+
+// Opens `filename` twice: once with O_DIRECT for the aligned blocks (if
+// requested and supported) and once without for the unaligned tail.
+class FilePair {
+   public:
+    FilePair(const std::string &filename, const int flags, const bool direct) {
+        using namespace std::literals;
+
+        _fd = open(filename.c_str(), flags, S_IRUSR | S_IWUSR);
+        if (_fd < 0) {
+            throw std::runtime_error("cannot open "s + filename);
+        }
+
+        _direct_fd = direct ? open(filename.c_str(), (flags & ~O_TRUNC) |
+                                                         O_DIRECT)
+                            : -1;
+        if (direct && _direct_fd < 0) {
+            std::cerr << "warning: " << filename
+                      << " does not support O_DIRECT, using buffered I/O\n";
+        }
+    }
+
+    FilePair(const FilePair &) = delete;
+    FilePair &operator=(const FilePair &) = delete;
+
+    ~FilePair() {
+        close(_fd);
+        if (_direct_fd >= 0) {
+            close(_direct_fd);
+        }
+    }
+
+    // File descriptor used to transfer up to `bytes` bytes at `offset` from or
+    // to `data + offset`; shrinks `bytes` such that O_DIRECT can be used for
+    // all but the unaligned tail of the file.
+    [[nodiscard]] int Get(const void *data, const std::uint64_t offset,
+                          std::size_t &bytes) const {
+        const std::uintptr_t address =
+            reinterpret_cast<std::uintptr_t>(data) + offset;
+        if (_direct_fd < 0 || address % kDirectAlignment != 0 ||
+            offset % kDirectAlignment != 0 || bytes < kDirectAlignment) {
+            return _fd;
+        }
+
+        bytes -= bytes % kDirectAlignment;
+        return _direct_fd;
+    }
+
+   private:
+    int _fd = -1;
+    int _direct_fd = -1;
+};
+
+// Transfers [0, bytes) block by block on all threads; `op` is pread() or a
+// wrapper around pwrite() and must return the number of transferred bytes.
+// Returns false if any transfer failed.
+template <typename Data, typename Op>
+bool ParallelTransfer(const FilePair &file, Data *data,
+                      const std::size_t bytes, Op &&op) {
+    std::atomic<bool> failed = false;
+
+    auto transfer_block = [&](const std::uint64_t block) {
+        std::uint64_t offset = block * kBlockSize;
+        const std::uint64_t end =
+            std::min<std::uint64_t>(bytes, offset + kBlockSize);
+
+        while (offset < end && !failed) {
+            std::size_t count = end - offset;
+            const int fd = file.Get(data, offset, count);
+
+            const ssize_t ans = op(fd, data + offset, count, offset);
+            if (ans < 0 && errno == EINTR) {
+                continue;
+            }
+            if (ans <= 0) {
+                failed = true;
+                return;
+            }
+            offset += ans;
+        }
+    };
+
+    ParallelFor(0, (bytes + kBlockSize - 1) / kBlockSize, 1,
+                [&](int, const std::uint64_t first, const std::uint64_t last) {
+                    for (std::uint64_t block = first; block < last; ++block) {
+                        transfer_block(block);
+                    }
+                });
+
+    return !failed;
+}
+
+}  // namespace internal
+
+// Reads the first `bytes` bytes of `filename` into `data` with all threads,
+// each of which preads disjoint blocks. With `direct`, blocks bypass the page
+// cache via O_DIRECT; this requires `data` to be page-aligned.
+inline void ParallelRead(const std::string &filename, void *data,
+                         const std::size_t bytes, const bool direct = false) {
+    using namespace std::literals;
+
+    const internal::FilePair file(filename, O_RDONLY, direct);
+    if (!internal::ParallelTransfer(file, static_cast<char *>(data), bytes,
+                                    pread)) {
+        throw std::runtime_error("cannot read from "s + filename);
+    }
+}
+
+// Replaces the contents of `filename` by [data, data + bytes) with all
+// threads, each of which pwrites disjoint blocks; see ParallelRead().
+inline void ParallelWrite(const std::string &filename, const void *data,
+                          const std::size_t bytes, const bool direct = false) {
+    using namespace std::literals;
+
+    const internal::FilePair file(filename, O_WRONLY | O_CREAT | O_TRUNC,
+                                  direct);
+    auto write = [](const int fd, const char *buf, const std::size_t count,
+                    const std::uint64_t offset) {
+        return pwrite(fd, buf, count, offset);
+    };
+    if (!internal::ParallelTransfer(file, static_cast<const char *>(data),
+                                    bytes, write)) {
+        throw std::runtime_error("cannot write to "s + filename);
+    }
+}
+
+// Read-only mapping of a whole file.
+class MappedFile {
+   public:
+    explicit MappedFile(const std::string &filename) {
+        using namespace std::literals;
+
+        _fd = open(filename.c_str(), O_RDONLY);
+        if (_fd < 0) {
+            throw std::runtime_error("cannot read from "s + filename);
+        }
+
+        struct stat file_info {};
+        if (fstat(_fd, &file_info) < 0) {
+            throw std::runtime_error("cannot stat "s + filename);
+        }
+        _length = static_cast<std::size_t>(file_info.st_size);
+        if (_length == 0) {
+            return;
+        }
+
+        _contents = static_cast<char *>(
+            mmap(nullptr, _length, PROT_READ, MAP_PRIVATE, _fd, 0));
+        if (_contents == MAP_FAILED) {
+            throw std::runtime_error("cannot mmap "s + filename);
+        }
+        huge_pages::AdviseFileMapping(_contents, _length, true);
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    ~MappedFile() {
+        if (_length > 0) {
+            munmap(_contents, _length);
+        }
+        close(_fd);
+    }
+
+    [[nodiscard]] const char *Data() const { return _contents; }
+
+    [[nodiscard]] std::size_t Length() const { return _length; }
+
+   private:
+    int _fd = -1;
+    std::size_t _length = 0;
+    char *_contents = nullptr;
+};
+
+// Writable mapping of a file that is created (or truncated) with a fixed
+// length, such that threads can write to precomputed offsets; the contents
+// reach the file when the mapping is destroyed. The disk space is allocated
+// upfront, so that a full disk is reported here rather than by SIGBUS while
+// writing through the mapping. The file descriptor is closed right away.
+class MappedOutputFile {
+   public:
+    MappedOutputFile(const std::string &filename, const std::size_t length)
+        : _length(length) {
+        using namespace std::literals;
+
+        const int fd = open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC,
+                            S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+        if (fd < 0) {
+            throw std::runtime_error("cannot write to "s + filename);
+        }
+        if (_length == 0) {
+            close(fd);
+            return;
+        }
+        if (posix_fallocate(fd, 0, static_cast<off_t>(_length)) != 0) {
+            close(fd);
+            throw std::runtime_error("cannot allocate "s +
+                                     std::to_string(_length) + " bytes for " +
+                                     filename);
+        }
+
+        _contents = static_cast<char *>(mmap(
+            nullptr, _length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+        close(fd);
+        if (_contents == MAP_FAILED) {
+            throw std::runtime_error("cannot mmap "s + filename);
+        }
+    }
+
+    MappedOutputFile(const MappedOutputFile &) = delete;
+    MappedOutputFile &operator=(const MappedOutputFile &) = delete;
+
+    ~MappedOutputFile() {
+        if (_length > 0) {
+            munmap(_contents, _length);
+        }
+    }
+
+    [[nodiscard]] char *Data() const { return _contents; }
+
+    [[nodiscard]] std::size_t Length() const { return _length; }
+
+   private:
+    std::size_t _length = 0;
+    char *_contents = nullptr;
+};
+
+}  // namespace hyperlink::io
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+namespace hyperlink {
+
+// Number of worker threads used by the parallel tools; can be overwritten by
+// setting HYPERLINK_NUM_THREADS.
+inline int NumThreads() {
+    if (const char *env = std::getenv("HYPERLINK_NUM_THREADS"); env) {
+        return std::max(1, std::atoi(env));
+    }
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Runs l(thread_id) on NumThreads() threads and waits for all of them.
+template <typename Lambda>
+inline void ParallelInvoke(Lambda &&l) {
+    const int num_threads = NumThreads();
+
+    std::vector<std::thread> threads;
+    threads.reserve(num_threads - 1);
+    for (int t = 1; t < num_threads; ++t) {
+        threads.emplace_back([&, t] { l(t); });
+    }
+    l(0);
+
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+}
+
+// Splits [begin, end) into chunks of at most `grain` elements and hands them
+// out dynamically, i.e., l(thread_id, chunk_begin, chunk_end) is called once
+// per chunk by whichever thread is idle.
+template <typename Lambda>
+inline void ParallelFor(const std::uint64_t begin, const std::uint64_t end,
+                        const std::uint64_t grain, Lambda &&l) {
+    std::atomic<std::uint64_t> next = begin;
+
+    ParallelInvoke([&](const int thread_id) {
+        for (std::uint64_t chunk = next.fetch_add(grain); chunk < end;
+             chunk = next.fetch_add(grain)) {
+            l(thread_id, chunk, std::min(end, chunk + grain));
+        }
+    });
+}
+
+}  // namespace hyperlink
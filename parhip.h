@@ -1,10 +1,22 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include <cassert>
 #include <cstdint>
 #include <fstream>
 #include <iostream>
 #include <limits>
+#include <stdexcept>
+#include <string>
 #include <vector>
 
+#include "allocator.h"
+#include "checksum.h"
+
 namespace hyperlink::parhip {
 
 using ID64 = unsigned long long;
@@ -49,9 +61,9 @@ inline ID64 EncodeVersion(const Version &version) {
     const ID64 vertex_id_width_bit =
         static_cast<int>(version.has_32bit_vertex_ids) << 3;
     const ID64 vertex_weight_width_bit =
-        static_cast<int>(version.has_32bit_vertex_weights) << 3;
+        static_cast<int>(version.has_32bit_vertex_weights) << 4;
     const ID64 edge_weight_width_bit =
-        static_cast<int>(version.has_32bit_edge_weights) << 4;
+        static_cast<int>(version.has_32bit_edge_weights) << 5;
 
     return vertex_weights_bit | edge_weights_bit | edge_id_width_bit |
            vertex_id_width_bit | vertex_weight_width_bit |
@@ -115,6 +127,53 @@ inline int EdgeWeightShift(const Header &header) {
     return header.version.has_32bit_edge_weights ? 2 : 3;
 }
 
+inline ID64 AdjncyOffset(const Header &header) {
+    return 3 * sizeof(ID64) + (header.n + 1) * EdgeIDWidth(header);
+}
+
+inline ID64 VertexWeightsOffset(const Header &header) {
+    return AdjncyOffset(header) + header.m * VertexIDWidth(header);
+}
+
+inline ID64 EdgeWeightsOffset(const Header &header) {
+    ID64 offset = VertexWeightsOffset(header);
+    if (header.version.has_vertex_weights) {
+        offset += header.n * VertexWeightWidth(header);
+    }
+    return offset;
+}
+
+// Number of bytes required to store the graph described by the header.
+inline ID64 GraphSize(const Header &header) {
+    ID64 size = EdgeWeightsOffset(header);
+    if (header.version.has_edge_weights) {
+        size += header.m * EdgeWeightWidth(header);
+    }
+    return size;
+}
+
+inline void WriteHeader(std::ofstream &out, const Header &header) {
+    const ID64 raw_header[3] = {EncodeVersion(header.version), header.n,
+                                header.m};
+    out.write(reinterpret_cast<const char *>(raw_header), sizeof(raw_header));
+}
+
+// Turns the vertex degrees stored in xadj[0..n) into the xadj[] array stored
+// in the file, i.e., the byte offsets of the adjacency lists. xadj[] must
+// have n + 1 entries and the graph must use 64-bit edge IDs.
+inline void DegreesToXadj(const Header &header, std::vector<ID64> &xadj) {
+    assert(!header.version.has_32bit_edge_ids && "requires 64 bit edge ids");
+    assert(xadj.size() == header.n + 1 && "invalid xadj[] size");
+
+    const ID64 width = VertexIDWidth(header);
+    ID64 offset = AdjncyOffset(header);
+    for (ID64 &x : xadj) {
+        const ID64 degree = x;
+        x = offset;
+        offset += degree * width;
+    }
+}
+
 template <typename Lambda>
 inline void DecodeXadj(const Header &header, const Data &xadj, Lambda &&l) {
     if (header.version.has_32bit_edge_ids) {
@@ -142,14 +201,27 @@ inline void DecodeXadjAdjncy(const Header &header, const Data &xadj_data,
     });
 }
 
-inline Data ReadXadj(std::ifstream &in, const Header &header) {
-    const std::size_t xadj_offset = 3 * sizeof(ID64);
-    in.seekg(xadj_offset, std::ios_base::beg);
-    assert(!in.rdstate() && "failed to seek to xadj");
+// Reads `nbytes` bytes at `offset`; if `checksums` are given, the blocks that
+// contain them are validated first.
+inline void ReadRange(std::ifstream &from, Data &to, const ID64 offset,
+                      const std::size_t nbytes,
+                      const checksum::Sidecar *checksums) {
+    if (checksums != nullptr) {
+        checksum::ReadVerified(from, *checksums, offset, nbytes, to);
+        return;
+    }
+
+    from.seekg(offset, std::ios_base::beg);
+    to.resize(nbytes);
+    from.read(to.data(), nbytes);
+}
 
+inline Data ReadXadj(std::ifstream &in, const Header &header,
+                     const checksum::Sidecar *checksums = nullptr) {
+    const std::size_t xadj_offset = 3 * sizeof(ID64);
     const std::size_t nbytes = (header.n + 1) * EdgeIDWidth(header);
-    Data xadj(nbytes);
-    in.read(xadj.data(), nbytes);
+    Data xadj;
+    ReadRange(in, xadj, xadj_offset, nbytes, checksums);
     assert(!in.rdstate() && "failed to read xadj");
 
     const int shift = VertexIDShift(header);
@@ -170,35 +242,211 @@ inline Data ReadXadj(std::ifstream &in, const Header &header) {
     return xadj;
 }
 
+// Entry of the normalized xadj[] array returned by ReadXadj(), i.e., the
+// index of the first edge of vertex i.
+inline ID64 XadjAt(const Header &header, const Data &xadj, const ID64 i) {
+    if (header.version.has_32bit_edge_ids) {
+        return reinterpret_cast<const ID32 *>(xadj.data())[i];
+    } else {
+        return reinterpret_cast<const ID64 *>(xadj.data())[i];
+    }
+}
+
 inline ID64 ReadAdjncy(std::ifstream &from, Data &to, const Header &header,
                        const Data &xadj, const ID64 begin_vertex = 0,
-                       ID64 end_vertex = std::numeric_limits<ID64>::max()) {
+                       ID64 end_vertex = std::numeric_limits<ID64>::max(),
+                       const checksum::Sidecar *checksums = nullptr) {
     end_vertex = std::min<ID64>(end_vertex, header.n);
     assert(end_vertex < xadj.size() && "invalid xadj[] size");
 
-    auto read_xadj = [&](const std::size_t i) -> ID64 {
-        if (header.version.has_32bit_edge_ids) {
-            return reinterpret_cast<const ID32 *>(xadj.data())[i];
-        } else {
-            return reinterpret_cast<const ID64 *>(xadj.data())[i];
-        }
+    auto read_xadj = [&](const std::size_t i) {
+        return XadjAt(header, xadj, i);
     };
 
     ID64 adjncy_offset = 3 * sizeof(ID64);
     adjncy_offset += (header.n + 1) * EdgeIDWidth(header);
     adjncy_offset += read_xadj(begin_vertex) * VertexIDWidth(header);
-    from.seekg(adjncy_offset, std::ios_base::beg);
 
     const std::size_t nbytes =
         (read_xadj(end_vertex) - read_xadj(begin_vertex)) *
         VertexIDWidth(header);
 
-    to.resize(nbytes);
-
-    from.read(to.data(), nbytes);
+    ReadRange(from, to, adjncy_offset, nbytes, checksums);
     assert(!from.rdstate() && "failed to read adjncy");
 
     return end_vertex - begin_vertex;
 }
 
+// Reads the weights of the vertices in [begin_vertex, end_vertex).
+inline void ReadVertexWeights(std::ifstream &from, Data &to,
+                              const Header &header, const ID64 begin_vertex,
+                              const ID64 end_vertex,
+                              const checksum::Sidecar *checksums = nullptr) {
+    assert(header.version.has_vertex_weights && "graph has no vertex weights");
+
+    const int width = VertexWeightWidth(header);
+    ReadRange(from, to, VertexWeightsOffset(header) + begin_vertex * width,
+              (end_vertex - begin_vertex) * width, checksums);
+    assert(!from.rdstate() && "failed to read vertex weights");
+}
+
+// Reads the weights of the edges incident to vertices in [begin_vertex,
+// end_vertex); `xadj` must be normalized as returned by ReadXadj().
+inline void ReadEdgeWeights(std::ifstream &from, Data &to,
+                            const Header &header, const Data &xadj,
+                            const ID64 begin_vertex, const ID64 end_vertex,
+                            const checksum::Sidecar *checksums = nullptr) {
+    assert(header.version.has_edge_weights && "graph has no edge weights");
+
+    const int width = EdgeWeightWidth(header);
+    const ID64 first_edge = XadjAt(header, xadj, begin_vertex);
+    ReadRange(from, to, EdgeWeightsOffset(header) + first_edge * width,
+              (XadjAt(header, xadj, end_vertex) - first_edge) * width,
+              checksums);
+    assert(!from.rdstate() && "failed to read edge weights");
+}
+
+// Typed view on a memory-mapped graph. xadj[] is not normalized, i.e., it
+// still contains the byte offsets stored in the file.
+template <typename EdgeID, typename VertexID>
+struct GraphView {
+    ID64 n;
+    ID64 m;
+    const EdgeID *raw_xadj;
+    const VertexID *adjncy;
+
+    [[nodiscard]] inline ID64 FirstEdge(const ID64 u) const {
+        return (raw_xadj[u] - raw_xadj[0]) / sizeof(VertexID);
+    }
+
+    [[nodiscard]] inline ID64 Degree(const ID64 u) const {
+        return (raw_xadj[u + 1] - raw_xadj[u]) / sizeof(VertexID);
+    }
+};
+
+// Splits the vertices into consecutive ranges of roughly equal numbers of
+// vertices plus edges; returns the first vertex of every range, followed by n.
+template <typename EdgeID, typename VertexID>
+std::vector<ID64> SplitIntoRanges(const GraphView<EdgeID, VertexID> &graph,
+                                  const ID64 num_ranges) {
+    const ID64 total = graph.n + graph.m;
+
+    std::vector<ID64> boundaries(num_ranges + 1, graph.n);
+    boundaries.front() = 0;
+    for (ID64 r = 1; r < num_ranges; ++r) {
+        const ID64 target = total * r / num_ranges;
+
+        ID64 lo = boundaries[r - 1];
+        ID64 hi = graph.n;
+        while (lo < hi) {
+            const ID64 mid = lo + (hi - lo) / 2;
+            if (mid + graph.FirstEdge(mid) < target) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        boundaries[r] = lo;
+    }
+    return boundaries;
+}
+
+class MappedGraph {
+   public:
+    explicit MappedGraph(const std::string &filename) {
+        using namespace std::literals;
+
+        _fd = open(filename.c_str(), O_RDONLY);
+        if (_fd < 0) {
+            throw std::runtime_error("cannot read from "s + filename);
+        }
+
+        struct stat file_info {};
+        if (fstat(_fd, &file_info) < 0) {
+            throw std::runtime_error("cannot stat "s + filename);
+        }
+        _length = static_cast<std::size_t>(file_info.st_size);
+        if (_length < 3 * sizeof(ID64)) {
+            throw std::runtime_error(filename + " is too small for a header"s);
+        }
+
+        _contents = static_cast<char *>(
+            mmap(nullptr, _length, PROT_READ, MAP_PRIVATE, _fd, 0));
+        if (_contents == MAP_FAILED) {
+            throw std::runtime_error("cannot mmap "s + filename);
+        }
+        huge_pages::AdviseFileMapping(_contents, _length, false);
+
+        const auto *raw_header = reinterpret_cast<const ID64 *>(_contents);
+        _header = {
+            .version = DecodeVersion(raw_header[0]),
+            .n = raw_header[1],
+            .m = raw_header[2],
+        };
+    }
+
+    MappedGraph(const MappedGraph &) = delete;
+    MappedGraph &operator=(const MappedGraph &) = delete;
+
+    ~MappedGraph() {
+        munmap(_contents, _length);
+        close(_fd);
+    }
+
+    // Checks whether the file is large enough to hold the arrays announced
+    // by the header; accessing the graph through Visit() is only safe if this
+    // returns true.
+    [[nodiscard]] bool HasValidSize() const {
+        return _length >= GraphSize(_header);
+    }
+
+    // Invokes l(GraphView<EdgeID, VertexID>) with the data types used by the
+    // file.
+    template <typename Lambda>
+    void Visit(Lambda &&l) const {
+        const char *xadj = _contents + 3 * sizeof(ID64);
+        const char *adjncy = _contents + AdjncyOffset(_header);
+
+        auto visit = [&]<typename EdgeID, typename VertexID>(const EdgeID *,
+                                                             const VertexID *) {
+            l(GraphView<EdgeID, VertexID>{
+                .n = _header.n,
+                .m = _header.m,
+                .raw_xadj = reinterpret_cast<const EdgeID *>(xadj),
+                .adjncy = reinterpret_cast<const VertexID *>(adjncy),
+            });
+        };
+
+        if (_header.version.has_32bit_edge_ids) {
+            if (_header.version.has_32bit_vertex_ids) {
+                visit(static_cast<const ID32 *>(nullptr),
+                      static_cast<const ID32 *>(nullptr));
+            } else {
+                visit(static_cast<const ID32 *>(nullptr),
+                      static_cast<const ID64 *>(nullptr));
+            }
+        } else {
+            if (_header.version.has_32bit_vertex_ids) {
+                visit(static_cast<const ID64 *>(nullptr),
+                      static_cast<const ID32 *>(nullptr));
+            } else {
+                visit(static_cast<const ID64 *>(nullptr),
+                      static_cast<const ID64 *>(nullptr));
+            }
+        }
+    }
+
+    [[nodiscard]] const Header &GetHeader() const { return _header; }
+
+    [[nodiscard]] std::size_t Length() const { return _length; }
+
+    [[nodiscard]] const char *Contents() const { return _contents; }
+
+   private:
+    int _fd = -1;
+    std::size_t _length = 0;
+    char *_contents = nullptr;
+    Header _header = {};
+};
+
 }  // namespace hyperlink::parhip
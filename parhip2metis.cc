@@ -1,30 +1,133 @@
+#include <cstdint>
+#include <exception>
 #include <fstream>
+#include <future>
 #include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include "buffered_writer.h"
+#include "checksum.h"
+#include "flags.h"
 #include "metis.h"
 #include "parhip.h"
+#include "report.h"
 
 using namespace hyperlink;
 
-int main(int argc, char *argv[]) {
-    if (argc < 3) {
-        std::cerr << "usage: ./parhip2metis <input.parhip> <output.metis> "
-                     "[<chunk size>]\n";
+// Default memory budget of one chunk of adjacency lists (and their weights);
+// two chunks are held in memory at a time.
+constexpr std::uint64_t kDefaultChunkSize = 256;
+
+struct Chunk {
+    std::uint64_t first_vertex = 0;
+    std::uint64_t last_vertex = 0;
+    parhip::Data adjncy;
+    parhip::Data vwgt;
+    parhip::Data ewgt;
+};
+
+// Splits the vertices into consecutive ranges whose adjacency lists and
+// weights take at most `budget` bytes; a vertex that exceeds the budget on its
+// own forms a range of its own. Returns the first vertex of every range,
+// followed by n.
+std::vector<std::uint64_t> SplitIntoChunks(const parhip::Header &header,
+                                           const parhip::Data &xadj,
+                                           const std::uint64_t budget) {
+    const std::uint64_t edge_bytes =
+        parhip::VertexIDWidth(header) +
+        (header.version.has_edge_weights ? parhip::EdgeWeightWidth(header)
+                                         : 0);
+    const std::uint64_t vertex_bytes =
+        header.version.has_vertex_weights ? parhip::VertexWeightWidth(header)
+                                          : 0;
+
+    auto bytes = [&](const std::uint64_t first, const std::uint64_t last) {
+        return (parhip::XadjAt(header, xadj, last) -
+                parhip::XadjAt(header, xadj, first)) *
+                   edge_bytes +
+               (last - first) * vertex_bytes;
+    };
+
+    std::vector<std::uint64_t> boundaries = {0};
+    while (boundaries.back() < header.n) {
+        const std::uint64_t first = boundaries.back();
+
+        // Binary search for the largest range that fits into the budget
+        std::uint64_t lo = first + 1;
+        std::uint64_t hi = header.n;
+        while (lo < hi) {
+            const std::uint64_t mid = lo + (hi - lo + 1) / 2;
+            if (bytes(first, mid) <= budget) {
+                lo = mid;
+            } else {
+                hi = mid - 1;
+            }
+        }
+        boundaries.push_back(lo);
+    }
+    return boundaries;
+}
+
+void ReadChunk(std::ifstream &in, const parhip::Header &header,
+               const parhip::Data &xadj, Chunk &chunk,
+               const checksum::Sidecar *checksums) {
+    parhip::ReadAdjncy(in, chunk.adjncy, header, xadj, chunk.first_vertex,
+                       chunk.last_vertex, checksums);
+    if (header.version.has_vertex_weights) {
+        parhip::ReadVertexWeights(in, chunk.vwgt, header, chunk.first_vertex,
+                                  chunk.last_vertex, checksums);
+    }
+    if (header.version.has_edge_weights) {
+        parhip::ReadEdgeWeights(in, chunk.ewgt, header, xadj,
+                                chunk.first_vertex, chunk.last_vertex,
+                                checksums);
+    }
+}
+
+// Invokes l() with a typed pointer to the weights, or a null pointer if the
+// graph has no such weights.
+template <typename Lambda>
+void DecodeWeights(const bool has_weights, const bool has_32bit_weights,
+                   const parhip::Data &weights, Lambda &&l) {
+    if (!has_weights) {
+        l(static_cast<const parhip::ID32 *>(nullptr));
+    } else if (has_32bit_weights) {
+        l(reinterpret_cast<const parhip::ID32 *>(weights.data()));
+    } else {
+        l(reinterpret_cast<const parhip::ID64 *>(weights.data()));
+    }
+}
+
+int main(int argc, const char *argv[]) {
+    report::Init(argc, argv);
+    const std::string chunk_size_flag = ExtractFlag(argc, argv, "chunk-size");
+    const bool verify = ExtractSwitch(argc, argv, "verify");
+
+    if (argc != 3) {
+        std::cerr << "usage: ./parhip2metis [--chunk-size=<MiB>] [--verify] "
+                     "<input.parhip> <output.metis>\n";
+        std::cerr << "The adjacency lists are converted in chunks of at most "
+                  << kDefaultChunkSize
+                  << " MiB (unless a single vertex needs more); the next "
+                     "chunk is read while the current one is written.\n";
+        std::cerr << "With --verify, every block that is read is checked "
+                     "against <input.parhip>.crc.\n";
         std::exit(1);
     }
 
     const std::string input_filename = argv[1];
     const std::string output_filename = argv[2];
     const std::uint64_t chunk_size =
-        argc == 4 ? std::stoull(argv[3])
-                  : std::numeric_limits<std::uint64_t>::max();
+        (chunk_size_flag.empty() ? kDefaultChunkSize
+                                 : std::stoull(chunk_size_flag)) *
+        1024 * 1024;
 
     std::cout << "In(parhip): " << input_filename << std::endl;
     std::cout << "Out(metis): " << output_filename << std::endl;
-    if (chunk_size != std::numeric_limits<std::uint64_t>::max()) {
-        std::cout << "Chunk size: " << chunk_size << std::endl;
-    }
+    std::cout << "Chunk size: " << chunk_size / 1024 / 1024 << " MiB"
+              << std::endl;
 
     BufferedTextOutput<> out(tag::create, output_filename);
 
@@ -34,6 +137,17 @@ int main(int argc, char *argv[]) {
         std::exit(1);
     }
 
+    checksum::Sidecar checksums;
+    if (verify) {
+        try {
+            checksums = checksum::ReadSidecar(input_filename);
+        } catch (const std::exception &e) {
+            std::cerr << "error: " << e.what() << "\n";
+            std::exit(1);
+        }
+    }
+    const checksum::Sidecar *checksums_ptr = verify ? &checksums : nullptr;
+
     std::cout << "Reading header ..." << std::endl;
     const parhip::Header parhip_header = parhip::ReadHeader(in);
 
@@ -67,27 +181,88 @@ int main(int argc, char *argv[]) {
     metis::WriteHeader(out, metis_header);
 
     std::cout << "Reading xadj[] array ..." << std::endl;
-    const auto xadj_data = parhip::ReadXadj(in, parhip_header);
+    parhip::Data xadj_data;
+    {
+        report::ScopedPhase phase("read_xadj");
+        try {
+            xadj_data = parhip::ReadXadj(in, parhip_header, checksums_ptr);
+        } catch (const std::exception &e) {
+            std::cerr << "error: " << e.what() << "\n";
+            std::exit(1);
+        }
+        report::AddBytesRead(3 * sizeof(parhip::ID64) + xadj_data.size());
+    }
     std::cout << "\tSize: " << xadj_data.size() << " bytes" << std::endl;
 
-    parhip::Data adjncy_data;
+    const std::vector<std::uint64_t> boundaries =
+        SplitIntoChunks(parhip_header, xadj_data, chunk_size);
+    std::cout << "Copying adjacency lists in " << boundaries.size() - 1
+              << " chunk(s) " << std::flush;
+    report::ScopedPhase phase("copy_adjncy");
 
-    std::cout << "Copying adjacency lists " << std::flush;
-    for (std::uint64_t u = 0; u < parhip_header.n; u += chunk_size) {
-        const std::uint64_t n = parhip::ReadAdjncy(
-            in, adjncy_data, parhip_header, xadj_data, u, u + chunk_size);
+    // The next chunk is read in the background while the current one is
+    // formatted; the reader owns the input stream until its future is ready
+    Chunk current;
+    Chunk next;
+    auto prefetch = [&](const std::size_t c) {
+        next.first_vertex = boundaries[c];
+        next.last_vertex = boundaries[c + 1];
+        return std::async(std::launch::async, [&] {
+            ReadChunk(in, parhip_header, xadj_data, next, checksums_ptr);
+        });
+    };
+
+    std::future<void> pending;
+    if (boundaries.size() > 1) {
+        pending = prefetch(0);
+    }
+
+    for (std::size_t c = 0; c + 1 < boundaries.size(); ++c) {
+        try {
+            pending.get();
+        } catch (const std::exception &e) {
+            std::cerr << "\nerror: " << e.what() << "\n";
+            std::exit(1);
+        }
+        std::swap(current, next);
+        if (c + 2 < boundaries.size()) {
+            pending = prefetch(c + 1);
+        }
+
+        const std::uint64_t u = current.first_vertex;
+        const std::uint64_t n = current.last_vertex - u;
 
         std::cout << "." << std::flush;
+        report::AddBytesRead(current.adjncy.size() + current.vwgt.size() +
+                             current.ewgt.size());
+        report::AddEdges(current.adjncy.size() /
+                         parhip::VertexIDWidth(parhip_header));
 
+        const parhip::Version &version = parhip_header.version;
         parhip::DecodeXadjAdjncy(
-            parhip_header, xadj_data, adjncy_data,
+            parhip_header, xadj_data, current.adjncy,
             [&]<typename EdgeID, typename VertexID>(const EdgeID *xadj,
                                                     const VertexID *adjncy) {
-                metis::WriteXadjAdjncy<VertexID, EdgeID>(out, n, xadj + u,
-                                                         adjncy);
+                DecodeWeights(
+                    version.has_vertex_weights,
+                    version.has_32bit_vertex_weights, current.vwgt,
+                    [&](const auto *vwgt) {
+                        DecodeWeights(version.has_edge_weights,
+                                      version.has_32bit_edge_weights,
+                                      current.ewgt, [&](const auto *ewgt) {
+                                          metis::WriteXadjAdjncy(
+                                              out, static_cast<VertexID>(n),
+                                              xadj + u, adjncy, vwgt, ewgt);
+                                      });
+                    });
             });
     }
     std::cout << std::endl;
 
+    if (!in) {
+        std::cerr << "error: input file is truncated\n";
+        std::exit(1);
+    }
+
     std::cout << "Done." << std::endl;
 }
@@ -0,0 +1,291 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "parallel.h"
+#include "parhip.h"
+#include "report.h"
+
+using namespace hyperlink;
+
+// Number of vertex ranges used to localize asymmetric edges.
+constexpr std::uint64_t kMaxSymmetryBuckets = 1ull << 16;
+constexpr std::uint64_t kGrainSize = 4096;
+
+inline std::uint64_t Mix(std::uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return x;
+}
+
+inline std::uint64_t EdgeHash(const std::uint64_t u, const std::uint64_t v,
+                              const std::uint64_t seed) {
+    return Mix(Mix(u ^ seed) + v);
+}
+
+struct Violation {
+    std::uint64_t count = 0;
+    std::uint64_t u = 0;
+    std::uint64_t v = 0;
+
+    void Record(const std::uint64_t from, const std::uint64_t to) {
+        if (count++ == 0) {
+            u = from;
+            v = to;
+        }
+    }
+
+    void Merge(const Violation &other) {
+        if (count == 0 || (other.count > 0 && other.u < u)) {
+            u = other.u;
+            v = other.v;
+        }
+        count += other.count;
+    }
+};
+
+struct LocalResult {
+    Violation out_of_range;
+    Violation self_loops;
+    Violation duplicates;
+    Violation unsorted;
+
+    // For every edge (u, v), we add H(u, v) to the bucket of u and subtract
+    // H(v, u) from the bucket of v. If the graph is symmetric, the reverse
+    // edge cancels both terms, i.e., every bucket must sum to zero. Two
+    // independent hash functions make false positives practically impossible.
+    std::vector<std::uint64_t> sums_a;
+    std::vector<std::uint64_t> sums_b;
+    std::vector<std::uint64_t> neighbors;
+};
+
+int main(int argc, const char *argv[]) {
+    report::Init(argc, argv);
+
+    if (argc != 2) {
+        std::cerr << "usage: ./parhipcheck <input.parhip>\n";
+        std::exit(1);
+    }
+
+    const std::string input_filename = argv[1];
+
+    try {
+        parhip::MappedGraph graph(input_filename);
+        const parhip::Header &header = graph.GetHeader();
+
+        std::cout << "In(parhip): " << input_filename << std::endl;
+        std::cout << "Checking header ..." << std::endl;
+        std::cout << "\tNumber of vertices: " << header.n << std::endl;
+        std::cout << "\tNumber of edges: " << header.m << std::endl;
+        std::cout << "\tFile size: " << graph.Length() << " bytes, expected "
+                  << parhip::GraphSize(header) << " bytes" << std::endl;
+
+        if (!graph.HasValidSize()) {
+            std::cerr << "error: file is truncated\n";
+            std::exit(1);
+        }
+
+        bool ok = true;
+        if (graph.Length() != parhip::GraphSize(header)) {
+            std::cout << "\tWarning: file has trailing data" << std::endl;
+        }
+        if (header.m % 2 != 0) {
+            std::cout << "\tOdd number of edges: graph cannot be symmetric"
+                      << std::endl;
+            ok = false;
+        }
+
+        graph.Visit([&]<typename EdgeID, typename VertexID>(
+                        const parhip::GraphView<EdgeID, VertexID> &view) {
+            const std::uint64_t n = view.n;
+
+            std::cout << "Checking xadj[] ..." << std::endl;
+            {
+                report::ScopedPhase xadj_phase("check_xadj");
+                if (view.raw_xadj[0] != parhip::AdjncyOffset(header)) {
+                    std::cout << "\txadj[0] is " << view.raw_xadj[0]
+                              << ", expected " << parhip::AdjncyOffset(header)
+                              << std::endl;
+                    ok = false;
+                    return;
+                }
+
+                std::atomic<std::uint64_t> first_bad_vertex = n;
+                auto check_xadj = [&](int, const std::uint64_t from,
+                                      const std::uint64_t to) {
+                    for (std::uint64_t u = from; u < to; ++u) {
+                        const EdgeID a = view.raw_xadj[u];
+                        const EdgeID b = view.raw_xadj[u + 1];
+                        if (a > b || (b - a) % sizeof(VertexID) != 0) {
+                            std::uint64_t cur = first_bad_vertex;
+                            while (u < cur &&
+                                   !first_bad_vertex.compare_exchange_weak(
+                                       cur, u)) {
+                            }
+                            return;
+                        }
+                    }
+                };
+                ParallelFor(0, n, kGrainSize * 16, check_xadj);
+
+                if (first_bad_vertex < n) {
+                    const std::uint64_t u = first_bad_vertex;
+                    std::cout << "\txadj[] is not monotone or misaligned at "
+                                 "vertex "
+                              << u << ": " << view.raw_xadj[u] << " -> "
+                              << view.raw_xadj[u + 1] << std::endl;
+                    ok = false;
+                    return;
+                }
+                if (view.FirstEdge(n) != header.m) {
+                    std::cout << "\txadj[n] points to edge "
+                              << view.FirstEdge(n) << ", expected "
+                              << header.m << std::endl;
+                    ok = false;
+                    return;
+                }
+
+                report::AddBytesRead(parhip::AdjncyOffset(header));
+            }
+
+            std::cout << "Checking adjncy[] ..." << std::endl;
+            report::ScopedPhase adjncy_phase("check_adjncy");
+
+            const std::uint64_t num_buckets =
+                std::max<std::uint64_t>(1, std::min(n, kMaxSymmetryBuckets));
+            const std::uint64_t bucket_width =
+                std::max<std::uint64_t>(1, (n + num_buckets - 1) / num_buckets);
+            constexpr std::uint64_t kSeedA = 0x9e3779b97f4a7c15ull;
+            constexpr std::uint64_t kSeedB = 0xc2b2ae3d27d4eb4full;
+
+            std::vector<LocalResult> results(NumThreads());
+            for (LocalResult &result : results) {
+                result.sums_a.resize(num_buckets);
+                result.sums_b.resize(num_buckets);
+            }
+
+            ParallelFor(
+                0, n, kGrainSize,
+                [&](const int thread_id, const std::uint64_t from,
+                    const std::uint64_t to) {
+                    LocalResult &result = results[thread_id];
+
+                    for (std::uint64_t u = from; u < to; ++u) {
+                        const VertexID *begin =
+                            view.adjncy + view.FirstEdge(u);
+                        const VertexID *end = begin + view.Degree(u);
+                        const std::uint64_t bucket_u = u / bucket_width;
+
+                        bool sorted = true;
+                        Violation duplicates;
+                        for (const VertexID *it = begin; it != end; ++it) {
+                            const std::uint64_t v = *it;
+
+                            if (v >= n) {
+                                result.out_of_range.Record(u, v);
+                                continue;
+                            }
+                            if (v == u) {
+                                result.self_loops.Record(u, v);
+                            }
+                            if (it != begin) {
+                                if (*(it - 1) == v) {
+                                    duplicates.Record(u, v);
+                                } else if (*(it - 1) > v) {
+                                    sorted = false;
+                                }
+                            }
+
+                            const std::uint64_t bucket_v = v / bucket_width;
+                            result.sums_a[bucket_u] += EdgeHash(u, v, kSeedA);
+                            result.sums_a[bucket_v] -= EdgeHash(v, u, kSeedA);
+                            result.sums_b[bucket_u] += EdgeHash(u, v, kSeedB);
+                            result.sums_b[bucket_v] -= EdgeHash(v, u, kSeedB);
+                        }
+
+                        // Duplicates are only guaranteed to be adjacent in
+                        // sorted adjacency lists; sort a copy of the others
+                        if (sorted) {
+                            result.duplicates.Merge(duplicates);
+                        } else {
+                            result.unsorted.Record(u, *begin);
+                            result.neighbors.assign(begin, end);
+                            std::sort(result.neighbors.begin(),
+                                      result.neighbors.end());
+                            for (std::size_t i = 1;
+                                 i < result.neighbors.size(); ++i) {
+                                const std::uint64_t v = result.neighbors[i];
+                                if (v < n && v == result.neighbors[i - 1]) {
+                                    result.duplicates.Record(u, v);
+                                }
+                            }
+                        }
+                    }
+                });
+
+            report::AddBytesRead(header.m * sizeof(VertexID));
+            report::AddEdges(header.m);
+
+            LocalResult total;
+            total.sums_a.resize(num_buckets);
+            total.sums_b.resize(num_buckets);
+            for (const LocalResult &result : results) {
+                total.out_of_range.Merge(result.out_of_range);
+                total.self_loops.Merge(result.self_loops);
+                total.duplicates.Merge(result.duplicates);
+                total.unsorted.Merge(result.unsorted);
+                for (std::uint64_t b = 0; b < num_buckets; ++b) {
+                    total.sums_a[b] += result.sums_a[b];
+                    total.sums_b[b] += result.sums_b[b];
+                }
+            }
+
+            auto report = [&](const char *what, const Violation &violation,
+                              const bool is_error) {
+                std::cout << "\t" << what << violation.count;
+                if (violation.count > 0) {
+                    std::cout << " (e.g., " << violation.u << " -> "
+                              << violation.v << ")";
+                    ok = ok && !is_error;
+                }
+                std::cout << std::endl;
+            };
+            report("Out-of-range targets:     ", total.out_of_range, true);
+            report("Self-loops:               ", total.self_loops, true);
+            report("Duplicate edges:          ", total.duplicates, true);
+            report("Unsorted adjacency lists: ", total.unsorted, false);
+
+            std::cout << "Checking symmetry ..." << std::endl;
+            std::uint64_t asymmetric_buckets = 0;
+            for (std::uint64_t b = 0; b < num_buckets; ++b) {
+                if (total.sums_a[b] != 0 || total.sums_b[b] != 0) {
+                    if (asymmetric_buckets < 10) {
+                        std::cout << "\tAsymmetric edges incident to "
+                                     "vertices in ["
+                                  << b * bucket_width << ", "
+                                  << std::min(n, (b + 1) * bucket_width)
+                                  << ")" << std::endl;
+                    }
+                    ++asymmetric_buckets;
+                }
+            }
+            std::cout << "\tAsymmetric vertex ranges: " << asymmetric_buckets
+                      << " of " << num_buckets << std::endl;
+            ok = ok && asymmetric_buckets == 0;
+        });
+
+        std::cout << (ok ? "OK." : "FAILED.") << std::endl;
+        return ok ? 0 : 1;
+    } catch (const std::exception &e) {
+        std::cerr << "error: " << e.what() << "\n";
+        std::exit(1);
+    }
+}
@@ -0,0 +1,348 @@
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "flags.h"
+#include "io.h"
+#include "parallel.h"
+#include "parhip.h"
+#include "report.h"
+
+using namespace hyperlink;
+
+// Number of vertices plus edges that one thread formats or copies at a time.
+constexpr std::uint64_t kRangeSize = 1ull << 20;
+
+// Writes text that is formatted in parallel: every thread formats its ranges
+// into a buffer of its own, and the buffers are written concurrently at the
+// offsets given by the prefix sum over their lengths.
+class ParallelTextWriter {
+   public:
+    explicit ParallelTextWriter(const std::string &filename) {
+        using namespace std::literals;
+
+        _fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC,
+                   S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+        if (_fd < 0) {
+            throw std::runtime_error("cannot write to "s + filename);
+        }
+        _filename = filename;
+    }
+
+    ParallelTextWriter(const ParallelTextWriter &) = delete;
+    ParallelTextWriter &operator=(const ParallelTextWriter &) = delete;
+
+    ~ParallelTextWriter() { close(_fd); }
+
+    void Write(const std::string &text) {
+        Write(text, _offset);
+        _offset += text.size();
+        Check();
+    }
+
+    // Appends format(r, buffer) for all ranges r in [0, num_ranges), in order;
+    // 4 * NumThreads() ranges are held in memory at a time.
+    template <typename Lambda>
+    void WriteRanges(const std::uint64_t num_ranges, Lambda &&format) {
+        const std::uint64_t batch_size = 4 * NumThreads();
+        std::vector<std::string> buffers(batch_size);
+        std::vector<std::uint64_t> offsets(batch_size + 1);
+
+        for (std::uint64_t first = 0; first < num_ranges;
+             first += batch_size) {
+            const std::uint64_t count =
+                std::min(batch_size, num_ranges - first);
+            ParallelFor(0, count, 1,
+                        [&](int, const std::uint64_t begin,
+                            const std::uint64_t end) {
+                            for (std::uint64_t i = begin; i < end; ++i) {
+                                buffers[i].clear();
+                                format(first + i, buffers[i]);
+                            }
+                        });
+
+            offsets[0] = _offset;
+            for (std::uint64_t i = 0; i < count; ++i) {
+                offsets[i + 1] = offsets[i] + buffers[i].size();
+            }
+            ParallelFor(0, count, 1,
+                        [&](int, const std::uint64_t begin,
+                            const std::uint64_t end) {
+                            for (std::uint64_t i = begin; i < end; ++i) {
+                                Write(buffers[i], offsets[i]);
+                            }
+                        });
+            _offset = offsets[count];
+            Check();
+        }
+    }
+
+    [[nodiscard]] std::uint64_t Size() const { return _offset; }
+
+   private:
+    void Write(const std::string &text, std::uint64_t offset) {
+        const char *data = text.data();
+        std::size_t remaining = text.size();
+        while (remaining > 0) {
+            const ssize_t written = pwrite(_fd, data, remaining, offset);
+            if (written <= 0) {
+                _failed = true;
+                return;
+            }
+            data += written;
+            offset += written;
+            remaining -= written;
+        }
+    }
+
+    void Check() const {
+        using namespace std::literals;
+
+        if (_failed) {
+            throw std::runtime_error("cannot write to "s + _filename);
+        }
+    }
+
+    int _fd = -1;
+    std::string _filename;
+    std::uint64_t _offset = 0;
+    std::atomic<bool> _failed = false;
+};
+
+inline void AppendUInt(std::string &buffer, const std::uint64_t value,
+                       const char separator) {
+    char digits[24];
+    char *end = std::to_chars(digits, digits + 20, value).ptr;
+    *end++ = separator;
+    buffer.append(digits, end);
+}
+
+// Calls l(first, last) on all threads for vertex ranges of roughly kRangeSize
+// vertices plus edges.
+template <typename EdgeID, typename VertexID, typename Lambda>
+void ForEachVertexRange(const parhip::GraphView<EdgeID, VertexID> &graph,
+                        Lambda &&l) {
+    const std::vector<parhip::ID64> ranges = parhip::SplitIntoRanges(
+        graph, (graph.n + graph.m) / kRangeSize + 1);
+    ParallelFor(0, ranges.size() - 1, 1,
+                [&](int, const std::uint64_t first, const std::uint64_t last) {
+                    for (std::uint64_t r = first; r < last; ++r) {
+                        l(ranges[r], ranges[r + 1]);
+                    }
+                });
+}
+
+// Serialized graph (.sg) of the GAP benchmark suite: a bool that is false for
+// undirected graphs, the number of (directed) edges and vertices as int64,
+// the int64 offsets of the adjacency lists and the int32 neighbors. adjncy[]
+// is copied as is if it already has 32-bit IDs.
+template <typename EdgeID, typename VertexID>
+std::uint64_t ExportGap(const parhip::GraphView<EdgeID, VertexID> &graph,
+                        const std::string &filename) {
+    using SGOffset = std::int64_t;
+    using SGID = std::int32_t;
+
+    constexpr auto kMaxVertices =
+        static_cast<parhip::ID64>(std::numeric_limits<SGID>::max());
+    if (graph.n > kMaxVertices) {
+        throw std::runtime_error("too many vertices for 32-bit GAP IDs");
+    }
+
+    const bool directed = false;
+    const SGOffset num_edges = graph.m;
+    const SGOffset num_nodes = graph.n;
+    const std::uint64_t offsets_begin =
+        sizeof(bool) + sizeof(num_edges) + sizeof(num_nodes);
+    const std::uint64_t neighbors_begin =
+        offsets_begin + (graph.n + 1) * sizeof(SGOffset);
+
+    io::MappedOutputFile out(filename,
+                             neighbors_begin + graph.m * sizeof(SGID));
+    char *data = out.Data();
+    std::memcpy(data, &directed, sizeof(bool));
+    std::memcpy(data + sizeof(bool), &num_edges, sizeof(num_edges));
+    std::memcpy(data + sizeof(bool) + sizeof(num_edges), &num_nodes,
+                sizeof(num_nodes));
+    std::memcpy(data + neighbors_begin - sizeof(SGOffset), &num_edges,
+                sizeof(SGOffset));
+
+    // The offsets are unaligned because of the leading bool
+    ForEachVertexRange(graph, [&](const std::uint64_t first,
+                                  const std::uint64_t last) {
+        for (std::uint64_t u = first; u < last; ++u) {
+            const SGOffset offset = graph.FirstEdge(u);
+            std::memcpy(data + offsets_begin + u * sizeof(SGOffset), &offset,
+                        sizeof(SGOffset));
+        }
+
+        const std::uint64_t first_edge = graph.FirstEdge(first);
+        const std::uint64_t last_edge = graph.FirstEdge(last);
+        char *neighbors = data + neighbors_begin + first_edge * sizeof(SGID);
+        if constexpr (sizeof(VertexID) == sizeof(SGID)) {
+            std::memcpy(neighbors, graph.adjncy + first_edge,
+                        (last_edge - first_edge) * sizeof(SGID));
+        } else {
+            for (std::uint64_t e = first_edge; e < last_edge; ++e) {
+                const SGID v = static_cast<SGID>(graph.adjncy[e]);
+                std::memcpy(neighbors + (e - first_edge) * sizeof(SGID), &v,
+                            sizeof(SGID));
+            }
+        }
+    });
+    return out.Length();
+}
+
+// Ligra's AdjacencyGraph text format: a header line, n, m, the n offsets and
+// the m neighbors, one number per line.
+template <typename EdgeID, typename VertexID>
+std::uint64_t ExportLigra(const parhip::GraphView<EdgeID, VertexID> &graph,
+                          const std::string &filename) {
+    ParallelTextWriter out(filename);
+    out.Write("AdjacencyGraph\n" + std::to_string(graph.n) + "\n" +
+              std::to_string(graph.m) + "\n");
+
+    out.WriteRanges((graph.n + kRangeSize - 1) / kRangeSize,
+                    [&](const std::uint64_t r, std::string &buffer) {
+                        const std::uint64_t last = std::min<std::uint64_t>(
+                            graph.n, (r + 1) * kRangeSize);
+                        for (std::uint64_t u = r * kRangeSize; u < last; ++u) {
+                            AppendUInt(buffer, graph.FirstEdge(u), '\n');
+                        }
+                    });
+    out.WriteRanges((graph.m + kRangeSize - 1) / kRangeSize,
+                    [&](const std::uint64_t r, std::string &buffer) {
+                        const std::uint64_t last = std::min<std::uint64_t>(
+                            graph.m, (r + 1) * kRangeSize);
+                        for (std::uint64_t e = r * kRangeSize; e < last; ++e) {
+                            AppendUInt(buffer, graph.adjncy[e], '\n');
+                        }
+                    });
+    return out.Size();
+}
+
+// Matrix Market coordinate format with one-based indices; every edge is
+// written, i.e., the matrix is declared general rather than symmetric.
+template <typename EdgeID, typename VertexID>
+std::uint64_t ExportMatrixMarket(
+    const parhip::GraphView<EdgeID, VertexID> &graph,
+    const std::string &filename) {
+    ParallelTextWriter out(filename);
+    out.Write("%%MatrixMarket matrix coordinate pattern general\n" +
+              std::to_string(graph.n) + " " + std::to_string(graph.n) + " " +
+              std::to_string(graph.m) + "\n");
+
+    const std::vector<parhip::ID64> ranges = parhip::SplitIntoRanges(
+        graph, (graph.n + graph.m) / kRangeSize + 1);
+    out.WriteRanges(ranges.size() - 1, [&](const std::uint64_t r,
+                                           std::string &buffer) {
+        for (std::uint64_t u = ranges[r]; u < ranges[r + 1]; ++u) {
+            const VertexID *begin = graph.adjncy + graph.FirstEdge(u);
+            const VertexID *end = begin + graph.Degree(u);
+            for (const VertexID *v = begin; v != end; ++v) {
+                AppendUInt(buffer, u + 1, ' ');
+                AppendUInt(buffer, *v + 1ull, '\n');
+            }
+        }
+    });
+    return out.Size();
+}
+
+// Binary edge list as read by edges2parhip: (u, v) pairs with the vertex ID
+// width of the graph, sorted by u.
+template <typename EdgeID, typename VertexID>
+std::uint64_t ExportEdgeList(const parhip::GraphView<EdgeID, VertexID> &graph,
+                             const std::string &filename) {
+    io::MappedOutputFile out(filename,
+                             graph.m * sizeof(std::pair<VertexID, VertexID>));
+    auto *edges = reinterpret_cast<std::pair<VertexID, VertexID> *>(out.Data());
+
+    ForEachVertexRange(graph, [&](const std::uint64_t first,
+                                  const std::uint64_t last) {
+        for (std::uint64_t u = first; u < last; ++u) {
+            const std::uint64_t first_edge = graph.FirstEdge(u);
+            const std::uint64_t degree = graph.Degree(u);
+            for (std::uint64_t e = first_edge; e < first_edge + degree; ++e) {
+                edges[e] = {static_cast<VertexID>(u), graph.adjncy[e]};
+            }
+        }
+    });
+    return out.Length();
+}
+
+int main(int argc, const char *argv[]) {
+    report::Init(argc, argv);
+    const std::string format = ExtractFlag(argc, argv, "format");
+
+    if (argc != 3 || (format != "gap" && format != "ligra" &&
+                      format != "mtx" && format != "edgelist")) {
+        std::cerr << "usage: ./parhipexport --format=<gap|ligra|mtx|edgelist> "
+                     "<input.parhip> <output>\n";
+        std::cerr << "Formats: GAP serialized graph (.sg, undirected), Ligra "
+                     "AdjacencyGraph, Matrix Market and binary edge list. The "
+                     "input graph must be symmetric for gap.\n";
+        std::exit(1);
+    }
+
+    const std::string input_filename = argv[1];
+    const std::string output_filename = argv[2];
+
+    if (std::ifstream test_out(output_filename, std::ios::binary); test_out) {
+        std::cerr << "error: output file already exists\n";
+        std::exit(1);
+    }
+
+    try {
+        parhip::MappedGraph graph(input_filename);
+        const parhip::Header &header = graph.GetHeader();
+
+        std::cout << "In(parhip): " << input_filename << std::endl;
+        std::cout << "Out(" << format << "): " << output_filename
+                  << std::endl;
+        if (!graph.HasValidSize()) {
+            std::cerr << "error: input file is truncated\n";
+            std::exit(1);
+        }
+        if (header.version.has_vertex_weights ||
+            header.version.has_edge_weights) {
+            std::cerr << "error: graphs with weights are not supported\n";
+            std::exit(1);
+        }
+
+        std::cout << "Exporting " << header.n << " vertices and " << header.m
+                  << " edges ..." << std::endl;
+        report::ScopedPhase phase("export");
+        graph.Visit([&](const auto &view) {
+            std::uint64_t written = 0;
+            if (format == "gap") {
+                written = ExportGap(view, output_filename);
+            } else if (format == "ligra") {
+                written = ExportLigra(view, output_filename);
+            } else if (format == "mtx") {
+                written = ExportMatrixMarket(view, output_filename);
+            } else {
+                written = ExportEdgeList(view, output_filename);
+            }
+            report::AddBytesRead(parhip::GraphSize(header));
+            report::AddBytesWritten(written);
+            report::AddEdges(header.m);
+        });
+    } catch (const std::exception &e) {
+        std::cerr << "error: " << e.what() << "\n";
+        std::exit(1);
+    }
+
+    std::cout << "Done." << std::endl;
+}
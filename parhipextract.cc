@@ -0,0 +1,384 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "allocator.h"
+#include "flags.h"
+#include "parallel.h"
+#include "parhip.h"
+#include "rank_bitmap.h"
+#include "report.h"
+#include "toker.h"
+#include "union_find.h"
+
+using namespace hyperlink;
+
+constexpr std::uint64_t kGrainSize = 4096;
+
+// Marks the vertices of the k-core. Vertices with degree < k are peeled in
+// rounds: removing a vertex decrements the degree of its neighbors, and every
+// neighbor whose degree drops from k to k - 1 joins the next round. Since that
+// transition happens at most once, every vertex is peeled at most once. The
+// graph must be symmetric.
+template <typename EdgeID, typename VertexID>
+RankBitmap KCore(const parhip::GraphView<EdgeID, VertexID> &graph,
+                 const std::uint64_t k) {
+    const std::uint64_t n = graph.n;
+
+    Buffer<std::uint64_t> degrees(n);
+    std::vector<std::vector<VertexID>> frontiers(NumThreads());
+    ParallelFor(0, n, kGrainSize,
+                [&](const int thread_id, const std::uint64_t first,
+                    const std::uint64_t last) {
+                    for (std::uint64_t u = first; u < last; ++u) {
+                        degrees[u] = graph.Degree(u);
+                        if (degrees[u] < k) {
+                            frontiers[thread_id].push_back(u);
+                        }
+                    }
+                });
+
+    std::vector<VertexID> frontier;
+    for (int round = 1;; ++round) {
+        frontier.clear();
+        for (std::vector<VertexID> &local : frontiers) {
+            frontier.insert(frontier.end(), local.begin(), local.end());
+            local.clear();
+        }
+        if (frontier.empty()) {
+            break;
+        }
+        std::cout << "\tRound " << round << ": peeling " << frontier.size()
+                  << " vertices" << std::endl;
+
+        ParallelFor(0, frontier.size(), kGrainSize / 16,
+                    [&](const int thread_id, const std::uint64_t first,
+                        const std::uint64_t last) {
+                        for (std::uint64_t i = first; i < last; ++i) {
+                            const VertexID u = frontier[i];
+                            const VertexID *begin =
+                                graph.adjncy + graph.FirstEdge(u);
+                            const VertexID *end = begin + graph.Degree(u);
+
+                            for (const VertexID *it = begin; it != end; ++it) {
+                                if (*it >= n) {
+                                    continue;
+                                }
+                                const std::uint64_t before =
+                                    std::atomic_ref<std::uint64_t>(
+                                        degrees[*it])
+                                        .fetch_sub(1,
+                                                   std::memory_order_relaxed);
+                                if (before == k) {
+                                    frontiers[thread_id].push_back(*it);
+                                }
+                            }
+                        }
+                    });
+    }
+
+    RankBitmap kept(n);
+    ParallelFor(0, n, kGrainSize,
+                [&](int, const std::uint64_t first, const std::uint64_t last) {
+                    for (std::uint64_t u = first; u < last; ++u) {
+                        if (degrees[u] >= k) {
+                            kept.Set(u);
+                        }
+                    }
+                });
+    kept.BuildRanks();
+    return kept;
+}
+
+// Marks the vertices of the weakly connected components with at least
+// `min_size` vertices, or of the largest component if `min_size` is 0.
+template <typename EdgeID, typename VertexID>
+RankBitmap MarkComponents(const parhip::GraphView<EdgeID, VertexID> &graph,
+                          const std::uint64_t min_size) {
+    const std::uint64_t n = graph.n;
+    const Components<VertexID> components = FindComponents(graph);
+    const Buffer<VertexID> &roots = components.roots;
+    const Buffer<VertexID> &sizes = components.sizes;
+    report::AddBytesRead(graph.m * sizeof(VertexID));
+    report::AddEdges(graph.m);
+
+    // Ties between largest components go to the one with the smallest root
+    struct Largest {
+        std::uint64_t size = 0;
+        std::uint64_t root = 0;
+    };
+    std::vector<Largest> largest(NumThreads());
+    std::vector<std::uint64_t> num_components(NumThreads());
+    ParallelFor(0, n, kGrainSize * 16,
+                [&](const int thread_id, const std::uint64_t first,
+                    const std::uint64_t last) {
+                    Largest &local = largest[thread_id];
+                    for (std::uint64_t u = first; u < last; ++u) {
+                        if (sizes[u] == 0) {
+                            continue;
+                        }
+                        ++num_components[thread_id];
+                        if (sizes[u] > local.size ||
+                            (sizes[u] == local.size && u < local.root)) {
+                            local = {sizes[u], u};
+                        }
+                    }
+                });
+    Largest total = largest.front();
+    for (const Largest &local : largest) {
+        if (local.size > total.size ||
+            (local.size == total.size && local.root < total.root)) {
+            total = local;
+        }
+    }
+    std::cout << "\tComponents: " << std::accumulate(num_components.begin(),
+                                                      num_components.end(),
+                                                      std::uint64_t{0})
+              << ", largest: " << total.size << " vertices" << std::endl;
+
+    RankBitmap kept(n);
+    ParallelFor(0, n, kGrainSize,
+                [&](int, const std::uint64_t first, const std::uint64_t last) {
+                    for (std::uint64_t u = first; u < last; ++u) {
+                        if (min_size == 0 ? roots[u] == total.root
+                                          : sizes[roots[u]] >= min_size) {
+                            kept.Set(u);
+                        }
+                    }
+                });
+    kept.BuildRanks();
+    return kept;
+}
+
+// Marks the vertices listed in a text file, separated by whitespace.
+RankBitmap ReadVertexList(const std::string &filename, const std::uint64_t n) {
+    if (std::ifstream in(filename); !in) {
+        std::cerr << "error: could not open vertex list " << filename << "\n";
+        std::exit(1);
+    }
+
+    RankBitmap kept(n);
+    MappedFileToker toker(filename);
+    toker.SkipSpaces();
+    while (toker.ValidPosition()) {
+        const std::size_t position = toker.Position();
+        const std::uint64_t u = toker.ScanUInt();
+        if (toker.Position() == position) {
+            std::cerr << "error: vertex list " << filename
+                      << " contains a non-numeric token at byte " << position
+                      << "\n";
+            std::exit(1);
+        }
+        if (u >= n) {
+            std::cerr << "error: vertex " << u << " in " << filename
+                      << " does not exist\n";
+            std::exit(1);
+        }
+        kept.Set(u);
+    }
+    report::AddBytesRead(toker.Length());
+
+    kept.BuildRanks();
+    return kept;
+}
+
+// Writes the subgraph induced by the kept vertices, relabeled by their rank.
+// The first pass counts the remaining degrees, the second one scatters the
+// remaining edges into their final positions. If the kept vertices are
+// `closed`, i.e., contain all neighbors of kept vertices, as components do,
+// the degrees are unchanged and the first pass does not read the edges.
+template <typename EdgeID, typename VertexID>
+void WriteInducedSubgraph(const parhip::GraphView<EdgeID, VertexID> &graph,
+                          const RankBitmap &kept,
+                          const std::string &output_filename,
+                          const bool closed = false) {
+    auto for_each_kept_neighbor = [&](const std::uint64_t u, auto &&l) {
+        const VertexID *begin = graph.adjncy + graph.FirstEdge(u);
+        const VertexID *end = begin + graph.Degree(u);
+        for (const VertexID *it = begin; it != end; ++it) {
+            if (*it < graph.n && kept.Get(*it)) {
+                l(*it);
+            }
+        }
+    };
+
+    std::vector<parhip::ID64> xadj(kept.Count() + 1);
+    ParallelFor(0, graph.n, kGrainSize,
+                [&](int, const std::uint64_t first, const std::uint64_t last) {
+                    for (std::uint64_t u = first; u < last; ++u) {
+                        if (!kept.Get(u)) {
+                            continue;
+                        }
+                        parhip::ID64 degree = 0;
+                        if (closed) {
+                            degree = graph.Degree(u);
+                        } else {
+                            for_each_kept_neighbor(
+                                u, [&](VertexID) { ++degree; });
+                        }
+                        xadj[kept.Rank(u)] = degree;
+                    }
+                });
+    std::exclusive_scan(xadj.begin(), xadj.end(), xadj.begin(),
+                        parhip::ID64{0});
+
+    Buffer<VertexID> adjncy(xadj.back());
+    ParallelFor(0, graph.n, kGrainSize,
+                [&](int, const std::uint64_t first, const std::uint64_t last) {
+                    for (std::uint64_t u = first; u < last; ++u) {
+                        if (!kept.Get(u)) {
+                            continue;
+                        }
+                        parhip::ID64 e = xadj[kept.Rank(u)];
+                        for_each_kept_neighbor(u, [&](const VertexID v) {
+                            adjncy[e++] = static_cast<VertexID>(kept.Rank(v));
+                        });
+                    }
+                });
+    report::AddBytesRead(graph.m * sizeof(VertexID));
+    report::AddEdges(graph.m);
+
+    const parhip::Header header{
+        .version =
+            {
+                .has_edge_weights = false,
+                .has_vertex_weights = false,
+                .has_32bit_edge_ids = false,
+                .has_32bit_vertex_ids = sizeof(VertexID) == 4,
+                .has_32bit_vertex_weights = false,
+                .has_32bit_edge_weights = false,
+            },
+        .n = kept.Count(),
+        .m = xadj.back(),
+    };
+    std::cout << "\tNumber of vertices: " << graph.n << " -> " << header.n
+              << std::endl;
+    std::cout << "\tNumber of edges: " << graph.m << " -> " << header.m
+              << std::endl;
+
+    std::ofstream out(output_filename, std::ios::binary | std::ios::trunc);
+    for (parhip::ID64 &x : xadj) {
+        x = parhip::AdjncyOffset(header) + x * sizeof(VertexID);
+    }
+    parhip::WriteHeader(out, header);
+    out.write(reinterpret_cast<const char *>(xadj.data()),
+              xadj.size() * sizeof(parhip::ID64));
+    out.write(reinterpret_cast<const char *>(adjncy.data()),
+              adjncy.size() * sizeof(VertexID));
+    if (!out) {
+        std::cerr << "error: cannot write to " << output_filename << "\n";
+        std::exit(1);
+    }
+    report::AddBytesWritten(parhip::GraphSize(header));
+}
+
+// Stores the old ID of every kept vertex, i.e., the inverse of the relabeling.
+template <typename VertexID>
+void WriteMapping(const RankBitmap &kept, const std::string &filename) {
+    std::vector<VertexID> mapping;
+    mapping.reserve(kept.Count());
+    kept.ForEachSetBit([&](const std::uint64_t u) { mapping.push_back(u); });
+
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char *>(mapping.data()),
+              mapping.size() * sizeof(VertexID));
+    if (!out) {
+        std::cerr << "error: cannot write to " << filename << "\n";
+        std::exit(1);
+    }
+    report::AddBytesWritten(mapping.size() * sizeof(VertexID));
+}
+
+int main(int argc, const char *argv[]) {
+    report::Init(argc, argv);
+    const std::string kcore = ExtractFlag(argc, argv, "kcore");
+    const std::string vertices_filename = ExtractFlag(argc, argv, "vertices");
+    const std::string components = ExtractFlag(argc, argv, "components");
+    const std::string mapping_filename = ExtractFlag(argc, argv, "mapping");
+    const int num_modes = !kcore.empty() + !vertices_filename.empty() +
+                          !components.empty();
+
+    if (argc != 3 || num_modes != 1) {
+        std::cerr << "usage: ./parhipextract (--kcore=<k> | "
+                     "--vertices=<list.txt> | --components=<largest or min "
+                     "size>) [--mapping=<mapping.bin>] <input.parhip> "
+                     "<output.parhip>\n";
+        std::cerr << "Writes the k-core, the subgraph induced by the listed "
+                     "vertices or the largest (weakly) connected component, "
+                     "respectively all components with at least the given "
+                     "number of vertices, with consecutive IDs; mapping.bin "
+                     "stores the old ID of every vertex.\n";
+        std::exit(1);
+    }
+
+    const std::string input_filename = argv[1];
+    const std::string output_filename = argv[2];
+
+    if (std::ifstream test_out(output_filename, std::ios::binary); test_out) {
+        std::cerr << "error: output file already exists\n";
+        std::exit(1);
+    }
+
+    try {
+        parhip::MappedGraph graph(input_filename);
+        const parhip::Header &header = graph.GetHeader();
+
+        std::cout << "In(parhip): " << input_filename << std::endl;
+        if (!graph.HasValidSize()) {
+            std::cerr << "error: input file is truncated\n";
+            std::exit(1);
+        }
+        if (header.version.has_vertex_weights ||
+            header.version.has_edge_weights) {
+            std::cerr << "error: graphs with weights are not supported\n";
+            std::exit(1);
+        }
+
+        graph.Visit([&]<typename EdgeID, typename VertexID>(
+                        const parhip::GraphView<EdgeID, VertexID> &view) {
+            RankBitmap kept;
+            if (!kcore.empty()) {
+                std::cout << "Computing the " << kcore << "-core ..."
+                          << std::endl;
+                report::ScopedPhase phase("kcore");
+                kept = KCore(view, std::stoull(kcore));
+            } else if (!vertices_filename.empty()) {
+                std::cout << "Reading vertex list ..." << std::endl;
+                report::ScopedPhase phase("read_vertices");
+                kept = ReadVertexList(vertices_filename, view.n);
+            } else {
+                std::cout << "Computing connected components ..."
+                          << std::endl;
+                report::ScopedPhase phase("components");
+                kept = MarkComponents(
+                    view, components == "largest"
+                              ? 0
+                              : std::max<std::uint64_t>(
+                                    1, std::stoull(components)));
+            }
+
+            std::cout << "Writing induced subgraph ..." << std::endl;
+            {
+                report::ScopedPhase phase("write");
+                WriteInducedSubgraph(view, kept, output_filename,
+                                     !components.empty());
+            }
+
+            if (!mapping_filename.empty()) {
+                report::ScopedPhase phase("write_mapping");
+                WriteMapping<VertexID>(kept, mapping_filename);
+            }
+        });
+    } catch (const std::exception &e) {
+        std::cerr << "error: " << e.what() << "\n";
+        std::exit(1);
+    }
+
+    std::cout << "Done." << std::endl;
+}
@@ -0,0 +1,239 @@
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "parhip.h"
+#include "pipeline.h"
+#include "report.h"
+
+using namespace hyperlink;
+
+struct MergeStats {
+    std::uint64_t duplicates = 0;
+    std::uint64_t self_loops = 0;
+};
+
+// Calls l(u, v) for every edge of the union of the graph and the delta edge
+// lists, in sorted order and without duplicates. The adjacency lists of the
+// graph must be sorted, the delta edge lists must be sorted by (u, v).
+// Vertices of the delta that do not exist in the graph are appended.
+template <typename EdgeID, typename VertexID, typename Lambda>
+void MergeEdges(const parhip::GraphView<EdgeID, VertexID> &graph,
+                const std::vector<std::string> &delta_filenames,
+                MergeStats &stats, Lambda &&l) {
+    std::vector<VertexID> delta_neighbors;
+
+    // Merges the adjacency list of u with its delta neighbors
+    auto finish_vertex = [&](const std::uint64_t u) {
+        std::uint64_t i = 0;
+        std::uint64_t j = 0;
+        const std::uint64_t first = u < graph.n ? graph.FirstEdge(u) : 0;
+        const std::uint64_t degree = u < graph.n ? graph.Degree(u) : 0;
+        bool has_prev = false;
+        VertexID prev = 0;
+
+        while (i < degree || j < delta_neighbors.size()) {
+            VertexID v;
+            if (j == delta_neighbors.size() ||
+                (i < degree && graph.adjncy[first + i] <= delta_neighbors[j])) {
+                v = graph.adjncy[first + i++];
+                if (i > 1 && v < graph.adjncy[first + i - 2]) {
+                    std::cerr << "error: adjacency list of vertex " << u
+                              << " in the input graph is not sorted\n";
+                    std::exit(1);
+                }
+            } else {
+                v = delta_neighbors[j++];
+                if (j > 1 && v < delta_neighbors[j - 2]) {
+                    std::cerr << "error: delta neighbors of vertex " << u
+                              << " are not sorted\n";
+                    std::exit(1);
+                }
+            }
+
+            if (has_prev && v == prev) {
+                ++stats.duplicates;
+                continue;
+            }
+
+            l(u, v);
+            has_prev = true;
+            prev = v;
+        }
+
+        delta_neighbors.clear();
+    };
+
+    RunMerger<VertexID> merger;
+    for (const std::string &delta_filename : delta_filenames) {
+        merger.AddFile(delta_filename);
+    }
+
+    std::uint64_t u = 0;
+    merger.ForEachEdge([&](const Edge<VertexID> &edge) {
+        const auto &[du, dv] = edge;
+        if (du < u) {
+            std::cerr << "error: delta edges are not sorted\n";
+            std::exit(1);
+        }
+        if (du == dv) {
+            ++stats.self_loops;
+            return;
+        }
+
+        for (; u < du; ++u) {
+            finish_vertex(u);
+        }
+        delta_neighbors.push_back(dv);
+    });
+    for (; u < graph.n || !delta_neighbors.empty(); ++u) {
+        finish_vertex(u);
+    }
+}
+
+template <typename EdgeID, typename VertexID>
+void Merge(const parhip::GraphView<EdgeID, VertexID> &graph,
+           const std::vector<std::string> &delta_filenames,
+           const std::string &output_filename) {
+    std::vector<parhip::ID64> xadj;
+    MergeStats stats;
+
+    std::cout << "Counting degrees ..." << std::endl;
+    {
+        report::ScopedPhase phase("count_degrees");
+
+        VertexID max_neighbor = 0;
+        auto count_edge = [&](const std::uint64_t u, const VertexID v) {
+            if (xadj.size() <= u) {
+                xadj.resize(u + 1);
+            }
+            ++xadj[u];
+            max_neighbor = std::max(max_neighbor, v);
+        };
+        MergeEdges(graph, delta_filenames, stats, count_edge);
+
+        // Vertices that only appear as neighbors in the delta
+        xadj.resize(std::max<std::uint64_t>(
+                        {graph.n, xadj.size(),
+                         xadj.empty() ? 0ull : max_neighbor + 1ull}) +
+                    1);
+    }
+
+    parhip::Header header{
+        .version =
+            {
+                .has_edge_weights = false,
+                .has_vertex_weights = false,
+                .has_32bit_edge_ids = false,
+                .has_32bit_vertex_ids = sizeof(VertexID) == 4,
+                .has_32bit_vertex_weights = false,
+                .has_32bit_edge_weights = false,
+            },
+        .n = xadj.size() - 1,
+        .m = 0,
+    };
+    for (const parhip::ID64 degree : xadj) {
+        header.m += degree;
+    }
+
+    std::cout << "\tNumber of vertices: " << graph.n << " -> " << header.n
+              << std::endl;
+    std::cout << "\tNumber of edges: " << graph.m << " -> " << header.m
+              << std::endl;
+    std::cout << "\tDuplicates removed: " << stats.duplicates << std::endl;
+    std::cout << "\tSelf-loops removed: " << stats.self_loops << std::endl;
+
+    std::cout << "Writing output file ..." << std::endl;
+    {
+        report::ScopedPhase phase("write");
+
+        std::ofstream out(output_filename, std::ios::binary | std::ios::trunc);
+        parhip::DegreesToXadj(header, xadj);
+        parhip::WriteHeader(out, header);
+        out.write(reinterpret_cast<const char *>(xadj.data()),
+                  xadj.size() * sizeof(parhip::ID64));
+
+        constexpr std::size_t buf_size = 1ull * 1024 * 1024;
+        std::vector<VertexID> adjncy;
+        adjncy.reserve(buf_size);
+
+        auto write_edge = [&](std::uint64_t, const VertexID v) {
+            adjncy.push_back(v);
+            if (adjncy.size() == buf_size) {
+                out.write(reinterpret_cast<const char *>(adjncy.data()),
+                          adjncy.size() * sizeof(VertexID));
+                adjncy.clear();
+            }
+        };
+        MergeStats ignored;
+        MergeEdges(graph, delta_filenames, ignored, write_edge);
+        out.write(reinterpret_cast<const char *>(adjncy.data()),
+                  adjncy.size() * sizeof(VertexID));
+
+        if (!out) {
+            std::cerr << "error: cannot write to " << output_filename << "\n";
+            std::exit(1);
+        }
+        report::AddBytesWritten(parhip::GraphSize(header));
+        report::AddEdges(header.m);
+    }
+}
+
+int main(int argc, const char *argv[]) {
+    report::Init(argc, argv);
+
+    if (argc < 4) {
+        std::cerr << "usage: ./parhipmerge <input.parhip> <output.parhip> "
+                     "<delta.bin> [<delta.rev.bin>...]\n";
+        std::cerr << "Delta files must be sorted and use the vertex ID width "
+                     "of the input graph; pass both directions of every new "
+                     "edge to keep the graph symmetric.\n";
+        std::exit(1);
+    }
+
+    const std::string input_filename = argv[1];
+    const std::string output_filename = argv[2];
+    const std::vector<std::string> delta_filenames(argv + 3, argv + argc);
+
+    if (std::ifstream test_out(output_filename, std::ios::binary); test_out) {
+        std::cerr << "error: output file already exists\n";
+        std::exit(1);
+    }
+    for (const std::string &delta_filename : delta_filenames) {
+        if (std::ifstream in(delta_filename, std::ios::binary); !in) {
+            std::cerr << "error: could not open delta file " << delta_filename
+                      << "\n";
+            std::exit(1);
+        }
+    }
+
+    try {
+        parhip::MappedGraph graph(input_filename);
+        const parhip::Header &header = graph.GetHeader();
+
+        std::cout << "In(parhip): " << input_filename << std::endl;
+        if (!graph.HasValidSize()) {
+            std::cerr << "error: input file is truncated\n";
+            std::exit(1);
+        }
+        if (header.version.has_vertex_weights ||
+            header.version.has_edge_weights) {
+            std::cerr << "error: graphs with weights are not supported\n";
+            std::exit(1);
+        }
+
+        graph.Visit([&](const auto &view) {
+            Merge(view, delta_filenames, output_filename);
+        });
+        report::AddBytesRead(2 * graph.Length());
+    } catch (const std::exception &e) {
+        std::cerr << "error: " << e.what() << "\n";
+        std::exit(1);
+    }
+
+    std::cout << "Done." << std::endl;
+}
@@ -0,0 +1,300 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "allocator.h"
+#include "io.h"
+#include "parallel.h"
+#include "parhip.h"
+#include "report.h"
+#include "toker.h"
+
+using namespace hyperlink;
+
+using BlockID = std::uint32_t;
+
+// Blocks whose sizes are printed individually.
+constexpr std::uint64_t kMaxListedBlocks = 64;
+
+// Reads one block ID per vertex, separated by whitespace, as written by KaHIP
+// and METIS.
+Buffer<BlockID> ReadPartition(const std::string &filename,
+                              const std::uint64_t n) {
+    if (std::ifstream in(filename); !in) {
+        std::cerr << "error: could not open partition " << filename << "\n";
+        std::exit(1);
+    }
+
+    Buffer<BlockID> partition(n);
+    std::uint64_t u = 0;
+
+    MappedFileToker toker(filename);
+    toker.SkipSpaces();
+    while (toker.ValidPosition()) {
+        const std::size_t position = toker.Position();
+        const std::uint64_t block = toker.ScanUInt();
+        if (toker.Position() == position) {
+            std::cerr << "error: partition " << filename
+                      << " contains a non-numeric token at byte " << position
+                      << "\n";
+            std::exit(1);
+        }
+        if (u == n) {
+            std::cerr << "error: partition " << filename
+                      << " has more entries than the graph has vertices\n";
+            std::exit(1);
+        }
+        partition[u++] = static_cast<BlockID>(block);
+    }
+    report::AddBytesRead(toker.Length());
+
+    if (u < n) {
+        std::cerr << "error: partition " << filename << " has " << u
+                  << " entries, but the graph has " << n << " vertices\n";
+        std::exit(1);
+    }
+    return partition;
+}
+
+// Writes the subgraph induced by every block and the cut edges. A counting
+// pass computes, for every range of vertices, how many vertices and internal
+// edges it contributes to every block, and how many cut edges it has. The
+// prefix sums over the ranges are the offsets at which the scatter pass writes
+// the range into the (memory-mapped) outputs, so both passes stream over the
+// graph once, regardless of the number of blocks. Within a block, vertices
+// keep their relative order.
+template <typename EdgeID, typename VertexID>
+void Split(const parhip::GraphView<EdgeID, VertexID> &graph,
+           const Buffer<BlockID> &partition, const std::string &prefix) {
+    const std::uint64_t k =
+        graph.n == 0
+            ? 0
+            : *std::max_element(partition.begin(), partition.end()) + 1ull;
+    const std::vector<parhip::ID64> ranges = parhip::SplitIntoRanges(
+        graph, std::max<std::uint64_t>(
+                   1, std::min<std::uint64_t>(4 * NumThreads(), graph.n)));
+    const std::uint64_t num_ranges = ranges.size() - 1;
+
+    struct Counts {
+        std::vector<std::uint64_t> vertices;
+        std::vector<std::uint64_t> edges;
+        std::uint64_t cut_edges = 0;
+    };
+    std::vector<Counts> counts(num_ranges + 1);
+    for (Counts &range : counts) {
+        range.vertices.resize(k);
+        range.edges.resize(k);
+    }
+
+    std::cout << "Counting vertices and edges of " << k << " block(s) ..."
+              << std::endl;
+    {
+        report::ScopedPhase phase("count");
+        std::atomic<bool> out_of_range = false;
+        ParallelFor(0, num_ranges, 1,
+                    [&](int, const std::uint64_t first,
+                        const std::uint64_t last) {
+                        for (std::uint64_t r = first; r < last; ++r) {
+                            Counts &range = counts[r];
+                            for (std::uint64_t u = ranges[r];
+                                 u < ranges[r + 1]; ++u) {
+                                const BlockID b = partition[u];
+                                ++range.vertices[b];
+
+                                const VertexID *begin =
+                                    graph.adjncy + graph.FirstEdge(u);
+                                const VertexID *end = begin + graph.Degree(u);
+                                for (const VertexID *v = begin; v != end;
+                                     ++v) {
+                                    if (*v >= graph.n) {
+                                        out_of_range = true;
+                                    } else if (partition[*v] == b) {
+                                        ++range.edges[b];
+                                    } else {
+                                        ++range.cut_edges;
+                                    }
+                                }
+                            }
+                        }
+                    });
+        if (out_of_range) {
+            std::cerr << "error: input graph has out-of-range neighbors\n";
+            std::exit(1);
+        }
+        report::AddBytesRead(graph.m * sizeof(VertexID));
+        report::AddEdges(graph.m);
+    }
+
+    // Exclusive prefix sums over the ranges; counts[num_ranges] holds the
+    // totals
+    for (std::uint64_t b = 0; b < k; ++b) {
+        std::uint64_t vertices = 0;
+        std::uint64_t edges = 0;
+        for (Counts &range : counts) {
+            vertices += std::exchange(range.vertices[b], vertices);
+            edges += std::exchange(range.edges[b], edges);
+        }
+    }
+    std::uint64_t cut_edges = 0;
+    for (Counts &range : counts) {
+        cut_edges += std::exchange(range.cut_edges, cut_edges);
+    }
+    const Counts &totals = counts.back();
+
+    // Local IDs are the ranks of the vertices within their block
+    Buffer<VertexID> local_ids(graph.n);
+    ParallelFor(0, num_ranges, 1,
+                [&](int, const std::uint64_t first, const std::uint64_t last) {
+                    for (std::uint64_t r = first; r < last; ++r) {
+                        std::vector<std::uint64_t> next = counts[r].vertices;
+                        for (std::uint64_t u = ranges[r]; u < ranges[r + 1];
+                             ++u) {
+                            local_ids[u] =
+                                static_cast<VertexID>(next[partition[u]]++);
+                        }
+                    }
+                });
+
+    std::vector<parhip::Header> headers(k);
+    std::vector<std::unique_ptr<io::MappedOutputFile>> outputs(k);
+    std::uint64_t output_size = 0;
+    for (std::uint64_t b = 0; b < k; ++b) {
+        headers[b] = {
+            .version =
+                {
+                    .has_edge_weights = false,
+                    .has_vertex_weights = false,
+                    .has_32bit_edge_ids = false,
+                    .has_32bit_vertex_ids = sizeof(VertexID) == 4,
+                    .has_32bit_vertex_weights = false,
+                    .has_32bit_edge_weights = false,
+                },
+            .n = totals.vertices[b],
+            .m = totals.edges[b],
+        };
+        outputs[b] = std::make_unique<io::MappedOutputFile>(
+            prefix + "." + std::to_string(b) + ".parhip",
+            parhip::GraphSize(headers[b]));
+        output_size += parhip::GraphSize(headers[b]);
+
+        auto *data = reinterpret_cast<parhip::ID64 *>(outputs[b]->Data());
+        data[0] = parhip::EncodeVersion(headers[b].version);
+        data[1] = headers[b].n;
+        data[2] = headers[b].m;
+        data[3 + headers[b].n] = parhip::AdjncyOffset(headers[b]) +
+                                 headers[b].m * sizeof(VertexID);
+
+        if (k <= kMaxListedBlocks) {
+            std::cout << "\tBlock " << b << ": " << headers[b].n
+                      << " vertices, " << headers[b].m << " edges"
+                      << std::endl;
+        }
+    }
+    std::cout << "\tCut edges: " << cut_edges << std::endl;
+
+    io::MappedOutputFile cut_output(
+        prefix + ".cut.bin", cut_edges * sizeof(std::pair<VertexID, VertexID>));
+    auto *cut = reinterpret_cast<std::pair<VertexID, VertexID> *>(
+        cut_output.Data());
+
+    std::cout << "Writing blocks ..." << std::endl;
+    report::ScopedPhase phase("write");
+    ParallelFor(
+        0, num_ranges, 1,
+        [&](int, const std::uint64_t first, const std::uint64_t last) {
+            for (std::uint64_t r = first; r < last; ++r) {
+                std::vector<std::uint64_t> next_edge = counts[r].edges;
+                std::uint64_t next_cut_edge = counts[r].cut_edges;
+
+                for (std::uint64_t u = ranges[r]; u < ranges[r + 1]; ++u) {
+                    const BlockID b = partition[u];
+                    const parhip::Header &header = headers[b];
+                    char *data = outputs[b]->Data();
+
+                    auto *xadj = reinterpret_cast<parhip::ID64 *>(data) + 3;
+                    auto *adjncy = reinterpret_cast<VertexID *>(
+                        data + parhip::AdjncyOffset(header));
+                    xadj[local_ids[u]] = parhip::AdjncyOffset(header) +
+                                         next_edge[b] * sizeof(VertexID);
+
+                    const VertexID *begin = graph.adjncy + graph.FirstEdge(u);
+                    const VertexID *end = begin + graph.Degree(u);
+                    for (const VertexID *v = begin; v != end; ++v) {
+                        if (partition[*v] == b) {
+                            adjncy[next_edge[b]++] = local_ids[*v];
+                        } else {
+                            cut[next_cut_edge++] = {static_cast<VertexID>(u),
+                                                    *v};
+                        }
+                    }
+                }
+            }
+        });
+    report::AddBytesRead(graph.m * sizeof(VertexID));
+    report::AddBytesWritten(output_size + cut_output.Length());
+    report::AddEdges(graph.m);
+}
+
+int main(int argc, const char *argv[]) {
+    report::Init(argc, argv);
+
+    if (argc != 4) {
+        std::cerr << "usage: ./parhipsplit <input.parhip> <partition.txt> "
+                     "<output prefix>\n";
+        std::cerr << "Writes the subgraph of every block b to "
+                     "<prefix>.<b>.parhip, with vertices numbered in their "
+                     "original order, and the edges between blocks to "
+                     "<prefix>.cut.bin as pairs of original IDs.\n";
+        std::exit(1);
+    }
+
+    const std::string input_filename = argv[1];
+    const std::string partition_filename = argv[2];
+    const std::string prefix = argv[3];
+
+    if (std::ifstream test_out(prefix + ".cut.bin", std::ios::binary);
+        test_out) {
+        std::cerr << "error: output file already exists\n";
+        std::exit(1);
+    }
+
+    try {
+        parhip::MappedGraph graph(input_filename);
+        const parhip::Header &header = graph.GetHeader();
+
+        std::cout << "In(parhip): " << input_filename << std::endl;
+        if (!graph.HasValidSize()) {
+            std::cerr << "error: input file is truncated\n";
+            std::exit(1);
+        }
+        if (header.version.has_vertex_weights ||
+            header.version.has_edge_weights) {
+            std::cerr << "error: graphs with weights are not supported\n";
+            std::exit(1);
+        }
+
+        std::cout << "Reading partition ..." << std::endl;
+        Buffer<BlockID> partition;
+        {
+            report::ScopedPhase phase("read_partition");
+            partition = ReadPartition(partition_filename, header.n);
+        }
+
+        graph.Visit([&]<typename EdgeID, typename VertexID>(
+                        const parhip::GraphView<EdgeID, VertexID> &view) {
+            Split(view, partition, prefix);
+        });
+    } catch (const std::exception &e) {
+        std::cerr << "error: " << e.what() << "\n";
+        std::exit(1);
+    }
+
+    std::cout << "Done." << std::endl;
+}
@@ -0,0 +1,168 @@
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "allocator.h"
+#include "parallel.h"
+#include "parhip.h"
+#include "report.h"
+#include "union_find.h"
+
+using namespace hyperlink;
+
+constexpr std::uint64_t kGrainSize = 4096;
+constexpr int kHistogramBins = 64;
+
+struct DegreeStats {
+    std::uint64_t isolated = 0;
+    std::uint64_t min_degree = std::numeric_limits<std::uint64_t>::max();
+    std::uint64_t max_degree = 0;
+
+    // histogram[i] counts vertices with degree in [2^i, 2^(i + 1))
+    std::vector<std::uint64_t> histogram =
+        std::vector<std::uint64_t>(kHistogramBins);
+
+    void Merge(const DegreeStats &other) {
+        isolated += other.isolated;
+        min_degree = std::min(min_degree, other.min_degree);
+        max_degree = std::max(max_degree, other.max_degree);
+        for (int i = 0; i < kHistogramBins; ++i) {
+            histogram[i] += other.histogram[i];
+        }
+    }
+};
+
+struct ComponentStats {
+    std::uint64_t components = 0;
+    std::uint64_t largest = 0;
+};
+
+// Only reads xadj[].
+template <typename EdgeID, typename VertexID>
+DegreeStats CountDegrees(const parhip::GraphView<EdgeID, VertexID> &graph) {
+    std::vector<DegreeStats> stats(NumThreads());
+    ParallelFor(0, graph.n, kGrainSize * 16,
+                [&](const int thread_id, const std::uint64_t first,
+                    const std::uint64_t last) {
+                    DegreeStats &local = stats[thread_id];
+                    for (std::uint64_t u = first; u < last; ++u) {
+                        const std::uint64_t degree = graph.Degree(u);
+                        local.min_degree = std::min(local.min_degree, degree);
+                        local.max_degree = std::max(local.max_degree, degree);
+                        if (degree == 0) {
+                            ++local.isolated;
+                        } else {
+                            ++local.histogram[std::bit_width(degree) - 1];
+                        }
+                    }
+                });
+
+    for (std::size_t t = 1; t < stats.size(); ++t) {
+        stats.front().Merge(stats[t]);
+    }
+    if (graph.n == 0) {
+        stats.front().min_degree = 0;
+    }
+    return stats.front();
+}
+
+// Counts the weakly connected components and the vertices of the largest one.
+template <typename EdgeID, typename VertexID>
+ComponentStats ComputeComponentStats(
+    const parhip::GraphView<EdgeID, VertexID> &graph) {
+    const std::uint64_t n = graph.n;
+    const Buffer<VertexID> sizes = FindComponents(graph).sizes;
+
+    std::vector<ComponentStats> stats(NumThreads());
+    ParallelFor(0, n, kGrainSize * 16,
+                [&](const int thread_id, const std::uint64_t first,
+                    const std::uint64_t last) {
+                    ComponentStats &local = stats[thread_id];
+                    for (std::uint64_t u = first; u < last; ++u) {
+                        if (sizes[u] > 0) {
+                            ++local.components;
+                            local.largest = std::max<std::uint64_t>(
+                                local.largest, sizes[u]);
+                        }
+                    }
+                });
+
+    ComponentStats total;
+    for (const ComponentStats &local : stats) {
+        total.components += local.components;
+        total.largest = std::max(total.largest, local.largest);
+    }
+    return total;
+}
+
+int main(int argc, const char *argv[]) {
+    report::Init(argc, argv);
+
+    if (argc != 2) {
+        std::cerr << "usage: ./parhipstats <input.parhip>\n";
+        std::cerr << "Prints the statistics of the graph as JSON.\n";
+        std::exit(1);
+    }
+
+    const std::string input_filename = argv[1];
+
+    try {
+        parhip::MappedGraph graph(input_filename);
+        const parhip::Header &header = graph.GetHeader();
+        if (!graph.HasValidSize()) {
+            std::cerr << "error: input file is truncated\n";
+            std::exit(1);
+        }
+
+        DegreeStats degrees;
+        ComponentStats components;
+        graph.Visit([&](const auto &view) {
+            {
+                report::ScopedPhase phase("count_degrees");
+                degrees = CountDegrees(view);
+                report::AddBytesRead(parhip::AdjncyOffset(header));
+            }
+            {
+                report::ScopedPhase phase("find_components");
+                components = ComputeComponentStats(view);
+                report::AddBytesRead(parhip::VertexWeightsOffset(header) -
+                                     parhip::AdjncyOffset(header));
+                report::AddEdges(header.m);
+            }
+        });
+
+        std::cout << "{\n";
+        std::cout << "  \"vertices\": " << header.n << ",\n";
+        std::cout << "  \"edges\": " << header.m << ",\n";
+        std::cout << "  \"min_degree\": " << degrees.min_degree << ",\n";
+        std::cout << "  \"max_degree\": " << degrees.max_degree << ",\n";
+        std::cout << "  \"avg_degree\": "
+                  << (header.n > 0 ? 1.0 * header.m / header.n : 0.0) << ",\n";
+        std::cout << "  \"isolated_vertices\": " << degrees.isolated << ",\n";
+        std::cout << "  \"degree_histogram\": [";
+        bool first_bin = true;
+        for (int i = 0; i < kHistogramBins; ++i) {
+            if (degrees.histogram[i] == 0) {
+                continue;
+            }
+            std::cout << (first_bin ? "\n" : ",\n") << "    {\"min\": "
+                      << (1ull << i) << ", \"max\": " << (1ull << i) * 2 - 1
+                      << ", \"count\": " << degrees.histogram[i] << "}";
+            first_bin = false;
+        }
+        std::cout << (first_bin ? "" : "\n  ") << "],\n";
+        std::cout << "  \"components\": " << components.components << ",\n";
+        std::cout << "  \"largest_component\": " << components.largest
+                  << "\n";
+        std::cout << "}" << std::endl;
+    } catch (const std::exception &e) {
+        std::cerr << "error: " << e.what() << "\n";
+        std::exit(1);
+    }
+}
@@ -0,0 +1,228 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "allocator.h"
+#include "flags.h"
+#include "parallel.h"
+#include "parhip.h"
+#include "report.h"
+
+using namespace hyperlink;
+
+constexpr std::uint64_t kGrainSize = 4096;
+
+// Splits the vertices into consecutive ranges whose transposed adjacency
+// lists fit into `max_edges` edges each; a single vertex with more in-edges
+// gets a range of its own. offsets[] holds the first transposed edge of every
+// vertex.
+std::vector<std::uint64_t> SplitIntoBlocks(
+    const std::vector<parhip::ID64> &offsets, const std::uint64_t max_edges) {
+    const std::uint64_t n = offsets.size() - 1;
+
+    std::vector<std::uint64_t> blocks = {0};
+    while (blocks.back() < n) {
+        const std::uint64_t lo = blocks.back();
+        const auto it = std::upper_bound(offsets.begin() + lo + 1,
+                                         offsets.end(), offsets[lo] + max_edges);
+        blocks.push_back(
+            std::max<std::uint64_t>(lo + 1, (it - offsets.begin()) - 1));
+    }
+    return blocks;
+}
+
+template <typename EdgeID, typename VertexID>
+void Transpose(const parhip::GraphView<EdgeID, VertexID> &graph,
+               const std::string &output_filename,
+               const std::uint64_t max_edges) {
+    const std::uint64_t n = graph.n;
+
+    // offsets[v] first counts the in-degree of v, then the first edge of v in
+    // the transposed graph
+    std::vector<parhip::ID64> offsets(n + 1);
+
+    std::cout << "Counting in-degrees ..." << std::endl;
+    {
+        report::ScopedPhase phase("count_degrees");
+
+        std::atomic<bool> out_of_range = false;
+        ParallelFor(0, n, kGrainSize,
+                    [&](int, const std::uint64_t first,
+                        const std::uint64_t last) {
+                        for (std::uint64_t u = first; u < last; ++u) {
+                            const VertexID *begin =
+                                graph.adjncy + graph.FirstEdge(u);
+                            const VertexID *end = begin + graph.Degree(u);
+                            for (const VertexID *it = begin; it != end; ++it) {
+                                if (*it >= n) {
+                                    out_of_range = true;
+                                    continue;
+                                }
+                                std::atomic_ref<parhip::ID64>(offsets[*it])
+                                    .fetch_add(1, std::memory_order_relaxed);
+                            }
+                        }
+                    });
+        if (out_of_range) {
+            std::cerr << "error: input graph has out-of-range neighbors\n";
+            std::exit(1);
+        }
+
+        std::exclusive_scan(offsets.begin(), offsets.end(), offsets.begin(),
+                            parhip::ID64{0});
+        report::AddBytesRead(graph.m * sizeof(VertexID));
+    }
+
+    const parhip::Header header{
+        .version =
+            {
+                .has_edge_weights = false,
+                .has_vertex_weights = false,
+                .has_32bit_edge_ids = false,
+                .has_32bit_vertex_ids = sizeof(VertexID) == 4,
+                .has_32bit_vertex_weights = false,
+                .has_32bit_edge_weights = false,
+            },
+        .n = n,
+        .m = offsets.back(),
+    };
+
+    std::ofstream out(output_filename, std::ios::binary | std::ios::trunc);
+
+    std::cout << "Writing xadj[] ..." << std::endl;
+    {
+        report::ScopedPhase phase("write_xadj");
+
+        std::vector<parhip::ID64> xadj(offsets);
+        for (parhip::ID64 &x : xadj) {
+            x = parhip::AdjncyOffset(header) + x * sizeof(VertexID);
+        }
+        parhip::WriteHeader(out, header);
+        out.write(reinterpret_cast<const char *>(xadj.data()),
+                  xadj.size() * sizeof(parhip::ID64));
+        report::AddBytesWritten(parhip::AdjncyOffset(header));
+    }
+
+    const std::vector<std::uint64_t> blocks =
+        SplitIntoBlocks(offsets, max_edges);
+    std::cout << "Transposing adjncy[] in " << blocks.size() - 1
+              << " block(s) ..." << std::endl;
+
+    // Every block scans the whole input graph and scatters the edges pointing
+    // into the block; the slots of a vertex are claimed atomically, thus its
+    // in-neighbors are sorted afterwards
+    for (std::size_t b = 0; b + 1 < blocks.size(); ++b) {
+        report::ScopedPhase phase("transpose_block");
+
+        const std::uint64_t lo = blocks[b];
+        const std::uint64_t hi = blocks[b + 1];
+        const parhip::ID64 base = offsets[lo];
+
+        Buffer<VertexID> adjncy(offsets[hi] - base);
+        std::vector<parhip::ID64> cursors(offsets.begin() + lo,
+                                          offsets.begin() + hi);
+
+        ParallelFor(0, n, kGrainSize,
+                    [&](int, const std::uint64_t first,
+                        const std::uint64_t last) {
+                        for (std::uint64_t u = first; u < last; ++u) {
+                            const VertexID *begin =
+                                graph.adjncy + graph.FirstEdge(u);
+                            const VertexID *end = begin + graph.Degree(u);
+                            for (const VertexID *it = begin; it != end; ++it) {
+                                if (*it < lo || *it >= hi) {
+                                    continue;
+                                }
+                                const parhip::ID64 pos =
+                                    std::atomic_ref<parhip::ID64>(
+                                        cursors[*it - lo])
+                                        .fetch_add(1,
+                                                   std::memory_order_relaxed);
+                                adjncy[pos - base] = static_cast<VertexID>(u);
+                            }
+                        }
+                    });
+
+        ParallelFor(lo, hi, kGrainSize,
+                    [&](int, const std::uint64_t first,
+                        const std::uint64_t last) {
+                        for (std::uint64_t v = first; v < last; ++v) {
+                            std::sort(adjncy.begin() + (offsets[v] - base),
+                                      adjncy.begin() + (offsets[v + 1] - base));
+                        }
+                    });
+
+        out.write(reinterpret_cast<const char *>(adjncy.data()),
+                  adjncy.size() * sizeof(VertexID));
+        report::AddBytesRead(graph.m * sizeof(VertexID));
+        report::AddBytesWritten(adjncy.size() * sizeof(VertexID));
+    }
+    report::AddEdges(header.m);
+
+    if (!out) {
+        std::cerr << "error: cannot write to " << output_filename << "\n";
+        std::exit(1);
+    }
+}
+
+int main(int argc, const char *argv[]) {
+    report::Init(argc, argv);
+    const std::string max_memory = ExtractFlag(argc, argv, "max-memory");
+
+    if (argc != 3) {
+        std::cerr << "usage: ./parhiptranspose [--max-memory=<GiB>] "
+                     "<input.parhip> <output.parhip>\n";
+        std::cerr << "With --max-memory, the transposed adjncy[] is built in "
+                     "blocks of at most that size, each of which rescans the "
+                     "input graph.\n";
+        std::exit(1);
+    }
+
+    const std::string input_filename = argv[1];
+    const std::string output_filename = argv[2];
+
+    if (std::ifstream test_out(output_filename, std::ios::binary); test_out) {
+        std::cerr << "error: output file already exists\n";
+        std::exit(1);
+    }
+
+    try {
+        parhip::MappedGraph graph(input_filename);
+        const parhip::Header &header = graph.GetHeader();
+
+        std::cout << "In(parhip): " << input_filename << std::endl;
+        std::cout << "\tNumber of vertices: " << header.n << std::endl;
+        std::cout << "\tNumber of edges: " << header.m << std::endl;
+        if (!graph.HasValidSize()) {
+            std::cerr << "error: input file is truncated\n";
+            std::exit(1);
+        }
+        if (header.version.has_vertex_weights ||
+            header.version.has_edge_weights) {
+            std::cerr << "error: graphs with weights are not supported\n";
+            std::exit(1);
+        }
+
+        graph.Visit([&]<typename EdgeID, typename VertexID>(
+                        const parhip::GraphView<EdgeID, VertexID> &view) {
+            const std::uint64_t max_edges =
+                max_memory.empty()
+                    ? view.m
+                    : static_cast<std::uint64_t>(std::stod(max_memory) *
+                                                 (1ull << 30)) /
+                          sizeof(VertexID);
+            Transpose(view, output_filename, max_edges);
+        });
+    } catch (const std::exception &e) {
+        std::cerr << "error: " << e.what() << "\n";
+        std::exit(1);
+    }
+
+    std::cout << "Done." << std::endl;
+}
@@ -0,0 +1,719 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "allocator.h"
+#include "ips4o.hpp"
+#include "parallel.h"
+#include "parhip.h"
+#include "toker.h"
+
+namespace hyperlink {
+
+template <typename NodeID>
+using Edge = std::pair<NodeID, NodeID>;
+
+// Number of occurrences of an edge in the input.
+using EdgeWeight = std::uint32_t;
+
+// Name of the file that stores the weights of the edges in `filename`, one
+// EdgeWeight per edge and in the same order.
+inline std::string WeightsFilename(const std::string &filename) {
+    return filename + ".weights";
+}
+
+// Estimates the number of lines of the files, i.e., an upper bound on the
+// number of edges, from the line lengths in evenly spaced samples.
+inline std::uint64_t EstimateLines(const std::vector<std::string> &filenames) {
+    constexpr std::uint64_t kNumSamples = 64;
+    constexpr std::uint64_t kSampleSize = 64 * 1024;
+
+    std::uint64_t lines = 0;
+    for (const std::string &filename : filenames) {
+        const MappedFileToker toker(filename);
+        const std::uint64_t length = toker.Length();
+        if (length <= kNumSamples * kSampleSize) {
+            lines += std::count(toker.Data(), toker.Data() + length, '\n');
+            continue;
+        }
+
+        std::uint64_t newlines = 0;
+        for (std::uint64_t i = 0; i < kNumSamples; ++i) {
+            const char *sample =
+                toker.Data() + (length - kSampleSize) * i / (kNumSamples - 1);
+            newlines += std::count(sample, sample + kSampleSize, '\n');
+        }
+        lines += length * newlines / (kNumSamples * kSampleSize);
+    }
+    return lines;
+}
+
+// Parses edges until the input is exhausted or `limit` edges were stored.
+// Edges are stored as (min(u, v), max(u, v)), self-loops are dropped. If
+// `weights` is given, the weight of every stored edge is appended to it, i.e.,
+// its weight column or 1. Returns false if a line does not match the dialect;
+// the toker is then positioned at the start of that line.
+template <typename NodeID, typename Dialect = PlainDialect, typename Edges,
+          typename Weights = std::vector<EdgeWeight>>
+inline bool ParseCanonicalEdges(MappedFileToker &toker, Edges &edges,
+                                const std::uint64_t limit,
+                                std::uint64_t &self_loops_removed,
+                                Weights *weights = nullptr) {
+    toker.SkipToEdge<Dialect>();
+    while (toker.ValidPosition() && edges.size() < limit) {
+        const std::size_t line = toker.Position();
+        std::uint64_t u = 0;
+        std::uint64_t v = 0;
+        std::uint64_t weight = 1;
+        if (!toker.ScanEdge<Dialect>(u, v, weight)) {
+            toker.Seek(line);
+            return false;
+        }
+
+        if (u == v) {
+            ++self_loops_removed;
+            continue;
+        }
+        edges.emplace_back(static_cast<NodeID>(std::min(u, v)),
+                           static_cast<NodeID>(std::max(u, v)));
+        if (weights != nullptr) {
+            weights->push_back(static_cast<EdgeWeight>(std::min<std::uint64_t>(
+                weight, std::numeric_limits<EdgeWeight>::max())));
+        }
+
+        if (sizeof(Edge<NodeID>) * edges.size() % (1024 * 1024 * 1024) == 0) {
+            std::cout << "\t" << toker.Position() / 1024 / 1024 / 1024
+                      << " GB, removed " << self_loops_removed
+                      << " self-loops (= "
+                      << sizeof(Edge<NodeID>) * self_loops_removed / 1024 /
+                             1024 / 1024
+                      << " GB)..." << std::endl;
+        }
+    }
+    return true;
+}
+
+// Parses the files concurrently, each one by a single thread, and appends their
+// edges (and weights) to `edges` as ParseCanonicalEdges() does. The order of
+// the edges is unspecified. Threads collect edges in small blocks and copy them
+// into the shared buffer, which is resized to `limit` edges upfront and should
+// thus not initialize its elements (see BufferAllocator). Returns false if the
+// files contain more than `limit` edges in total; throws if a line does not
+// match the dialect.
+template <typename NodeID, typename Dialect = PlainDialect, typename Edges,
+          typename Weights = std::vector<EdgeWeight>>
+inline bool ParseCanonicalEdgesFromFiles(
+    const std::vector<std::string> &filenames, Edges &edges,
+    const std::uint64_t limit, std::uint64_t &self_loops_removed,
+    Weights *weights = nullptr) {
+    using namespace std::literals;
+    constexpr std::size_t kBlockSize = 1024 * 1024;
+    constexpr std::uint64_t kWellFormed =
+        std::numeric_limits<std::uint64_t>::max();
+
+    std::atomic<std::uint64_t> size = edges.size();
+    std::atomic<std::uint64_t> self_loops = 0;
+    std::atomic<bool> overflow = false;
+    std::atomic<bool> malformed = false;
+    std::vector<std::uint64_t> malformed_at(filenames.size(), kWellFormed);
+    edges.resize(std::max<std::uint64_t>(edges.size(), limit));
+    if (weights != nullptr) {
+        weights->resize(edges.size());
+    }
+
+    auto parse_files = [&](int, const std::uint64_t first,
+                           const std::uint64_t last) {
+        std::vector<Edge<NodeID>> block;
+        block.reserve(kBlockSize);
+        std::vector<EdgeWeight> block_weights;
+        block_weights.reserve(weights != nullptr ? kBlockSize : 0);
+
+        for (std::uint64_t f = first; f < last; ++f) {
+            MappedFileToker toker(filenames[f]);
+            std::uint64_t file_edges = 0;
+            std::uint64_t file_self_loops = 0;
+
+            while (toker.ValidPosition() && !overflow && !malformed) {
+                block.clear();
+                block_weights.clear();
+                const bool well_formed = ParseCanonicalEdges<NodeID, Dialect>(
+                    toker, block, kBlockSize, file_self_loops,
+                    weights != nullptr ? &block_weights : nullptr);
+
+                const std::uint64_t offset = size.fetch_add(block.size());
+                if (offset + block.size() > limit) {
+                    overflow = true;
+                    break;
+                }
+                std::copy(block.begin(), block.end(), edges.begin() + offset);
+                if (weights != nullptr) {
+                    std::copy(block_weights.begin(), block_weights.end(),
+                              weights->begin() + offset);
+                }
+                file_edges += block.size();
+
+                if (!well_formed) {
+                    malformed_at[f] = toker.Position();
+                    malformed = true;
+                    break;
+                }
+            }
+            self_loops += file_self_loops;
+
+            std::stringstream ss;
+            ss << "\t" << filenames[f] << ": " << file_edges << " edges, "
+               << file_self_loops << " self-loops\n";
+            std::cout << ss.str() << std::flush;
+        }
+    };
+    ParallelFor(0, filenames.size(), 1, parse_files);
+
+    for (std::size_t f = 0; f < filenames.size(); ++f) {
+        if (malformed_at[f] != kWellFormed) {
+            throw std::runtime_error("malformed line in "s + filenames[f] +
+                                     " at byte " +
+                                     std::to_string(malformed_at[f]));
+        }
+    }
+
+    edges.resize(std::min<std::uint64_t>(size, limit));
+    if (weights != nullptr) {
+        weights->resize(edges.size());
+    }
+    self_loops_removed += self_loops;
+    return !overflow;
+}
+
+// k-way merge of sorted edge runs, each of which is either stored in a file
+// or in memory.
+template <typename NodeID, std::size_t buf_size = 1ull * 1024 * 1024>
+class RunMerger {
+    using Edge = hyperlink::Edge<NodeID>;
+
+   public:
+    void AddFile(const std::string &filename) {
+        Run &run = _runs.emplace_back();
+        run.in.open(filename, std::ios::binary);
+        run.in.seekg(0, std::ios::end);
+        run.size = static_cast<std::size_t>(run.in.tellg()) / sizeof(Edge);
+        run.in.seekg(0, std::ios::beg);
+        run.buf.resize(std::min(buf_size, run.size));
+        Refill(run);
+    }
+
+    void AddMemory(const Edge *begin, const Edge *end) {
+        Run &run = _runs.emplace_back();
+        run.data = begin;
+        run.size = end - begin;
+    }
+
+    // Calls l(edge) for every edge in sorted order.
+    template <typename Lambda>
+    void ForEachEdge(Lambda &&l) {
+        const std::size_t num_runs = _runs.size();
+        if (num_runs == 0) {
+            return;
+        }
+
+        std::uint64_t remaining = 0;
+        std::vector<std::pair<Edge, std::size_t>> tree(2 * num_runs);
+        for (std::size_t r = 0; r < num_runs; ++r) {
+            tree[num_runs + r] = {Get(_runs[r]), r};
+            remaining += _runs[r].size;
+        }
+        for (std::size_t i = num_runs - 1; i > 0; --i) {
+            tree[i] = std::min(tree[i * 2], tree[i * 2 + 1]);
+        }
+
+        for (; remaining > 0; --remaining) {
+            const auto [edge, r] = tree[1];
+            l(edge);
+
+            Run &run = _runs[r];
+            ++run.pos;
+            if (run.in.is_open() && run.pos % buf_size == 0) {
+                Refill(run);
+            }
+
+            tree[num_runs + r] = {Get(run), r};
+            for (std::size_t i = (num_runs + r) >> 1; i > 0; i >>= 1) {
+                tree[i] = std::min(tree[i * 2], tree[i * 2 + 1]);
+            }
+        }
+    }
+
+   private:
+    struct Run {
+        std::ifstream in;
+        std::vector<Edge> buf;
+        const Edge *data = nullptr;
+        std::size_t size = 0;
+        std::size_t pos = 0;
+    };
+
+    static void Refill(Run &run) {
+        const std::size_t n = std::min(buf_size, run.size - run.pos);
+        run.in.read(reinterpret_cast<char *>(run.buf.data()),
+                    n * sizeof(Edge));
+    }
+
+    static Edge Get(const Run &run) {
+        if (run.pos == run.size) {
+            // Can never be a real edge since self-loops are removed
+            return {std::numeric_limits<NodeID>::max(),
+                    std::numeric_limits<NodeID>::max()};
+        }
+        if (run.data != nullptr) {
+            return run.data[run.pos];
+        }
+        return run.buf[run.pos % buf_size];
+    }
+
+    std::vector<Run> _runs;
+};
+
+// Natural runs are only merged if there are at most kMaxNaturalRuns of them and
+// they have kMinNaturalRunLength edges on average; otherwise, the edges are
+// sorted from scratch.
+constexpr std::uint64_t kMaxNaturalRuns = 4096;
+constexpr std::uint64_t kMinNaturalRunLength = 4096;
+
+namespace internal {
+
+constexpr std::uint64_t kPresortGrainSize = 1ull << 20;
+
+// Returns the first edge of every maximal sorted run, followed by the number of
+// edges, or nothing if there are more than `max_runs` runs.
+template <typename Edge>
+std::vector<std::uint64_t> FindNaturalRuns(const Edge *edges,
+                                           const std::uint64_t size,
+                                           const std::uint64_t max_runs) {
+    std::vector<std::vector<std::uint64_t>> starts(NumThreads());
+    std::atomic<std::uint64_t> num_runs = 1;
+    ParallelFor(1, std::max<std::uint64_t>(1, size), kPresortGrainSize,
+                [&](const int thread_id, const std::uint64_t first,
+                    const std::uint64_t last) {
+                    for (std::uint64_t i = first;
+                         i < last && num_runs <= max_runs; ++i) {
+                        if (edges[i] < edges[i - 1]) {
+                            starts[thread_id].push_back(i);
+                            ++num_runs;
+                        }
+                    }
+                });
+    if (num_runs > max_runs) {
+        return {};
+    }
+
+    std::vector<std::uint64_t> runs = {0};
+    for (const std::vector<std::uint64_t> &local : starts) {
+        runs.insert(runs.end(), local.begin(), local.end());
+    }
+    std::sort(runs.begin(), runs.end());
+    runs.push_back(size);
+    return runs;
+}
+
+// Merges the sorted runs [runs[r], runs[r + 1]) of `from` into `to`. The
+// output is split at splitters sampled from all runs, and every part is merged
+// by a single thread.
+template <typename Edge>
+void MergeRuns(const Edge *from, const std::vector<std::uint64_t> &runs,
+               Edge *to) {
+    using NodeID = typename Edge::first_type;
+
+    const std::size_t num_runs = runs.size() - 1;
+    const std::size_t num_parts = std::clamp<std::uint64_t>(
+        runs.back() / kPresortGrainSize, 1, 4 * NumThreads());
+
+    std::vector<Edge> samples;
+    for (std::size_t r = 0; r < num_runs; ++r) {
+        const std::uint64_t length = runs[r + 1] - runs[r];
+        for (std::size_t i = 0; length > 0 && i < num_parts; ++i) {
+            samples.push_back(from[runs[r] + length * i / num_parts]);
+        }
+    }
+    std::sort(samples.begin(), samples.end());
+
+    // cuts[p][r] is the first edge of run r that belongs to part p
+    std::vector<std::vector<std::uint64_t>> cuts(
+        num_parts + 1, std::vector<std::uint64_t>(num_runs));
+    for (std::size_t r = 0; r < num_runs; ++r) {
+        cuts.front()[r] = runs[r];
+        cuts.back()[r] = runs[r + 1];
+    }
+    ParallelFor(1, num_parts, 1,
+                [&](int, const std::uint64_t first, const std::uint64_t last) {
+                    for (std::uint64_t p = first; p < last; ++p) {
+                        const Edge &splitter =
+                            samples[p * samples.size() / num_parts];
+                        for (std::size_t r = 0; r < num_runs; ++r) {
+                            cuts[p][r] =
+                                std::lower_bound(from + runs[r],
+                                                 from + runs[r + 1], splitter) -
+                                from;
+                        }
+                    }
+                });
+
+    ParallelFor(0, num_parts, 1,
+                [&](int, const std::uint64_t first, const std::uint64_t last) {
+                    for (std::uint64_t p = first; p < last; ++p) {
+                        std::uint64_t offset = 0;
+                        RunMerger<NodeID> merger;
+                        for (std::size_t r = 0; r < num_runs; ++r) {
+                            offset += cuts[p][r] - runs[r];
+                            merger.AddMemory(from + cuts[p][r],
+                                             from + cuts[p + 1][r]);
+                        }
+
+                        Edge *out = to + offset;
+                        merger.ForEachEdge(
+                            [&](const Edge &edge) { *out++ = edge; });
+                    }
+                });
+}
+
+// Greedily splits the edges into an ascending subsequence, i.e., every edge
+// that is not smaller than the previously kept one, and the remaining edges.
+// The edges are cut into chunks that are scanned in parallel; a chunk whose
+// first edge is smaller than the last kept edge of its predecessors is
+// rescanned with that edge as threshold.
+template <typename Edge>
+class AscendingSplit {
+   public:
+    AscendingSplit(const Edge *edges, const std::uint64_t size)
+        : _edges(edges),
+          _size(size),
+          _chunks((size + kPresortGrainSize - 1) / kPresortGrainSize) {
+        ParallelFor(0, _chunks.size(), 1,
+                    [&](int, const std::uint64_t first,
+                        const std::uint64_t last) {
+                        for (std::uint64_t c = first; c < last; ++c) {
+                            Scan(c, nullptr);
+                        }
+                    });
+
+        const Edge *threshold = nullptr;
+        for (std::size_t c = 0; c < _chunks.size(); ++c) {
+            if (threshold != nullptr && _edges[Begin(c)] < *threshold) {
+                Scan(c, threshold);
+            }
+            if (_chunks[c].last_kept != nullptr) {
+                threshold = _chunks[c].last_kept;
+            }
+        }
+    }
+
+    [[nodiscard]] std::uint64_t Kept() const {
+        std::uint64_t kept = 0;
+        for (const Chunk &chunk : _chunks) {
+            kept += chunk.kept;
+        }
+        return kept;
+    }
+
+    // Copies the kept edges to the front of `to` and the remaining ones behind
+    // them, both in their original order.
+    void Scatter(Edge *to) const {
+        std::vector<std::uint64_t> kept_offsets(_chunks.size() + 1);
+        std::vector<std::uint64_t> rest_offsets(_chunks.size() + 1);
+        for (std::size_t c = 0; c < _chunks.size(); ++c) {
+            kept_offsets[c + 1] = kept_offsets[c] + _chunks[c].kept;
+            rest_offsets[c + 1] =
+                rest_offsets[c] + (End(c) - Begin(c) - _chunks[c].kept);
+        }
+
+        ParallelFor(0, _chunks.size(), 1,
+                    [&](int, const std::uint64_t first,
+                        const std::uint64_t last) {
+                        for (std::uint64_t c = first; c < last; ++c) {
+                            Edge *kept = to + kept_offsets[c];
+                            Edge *rest =
+                                to + kept_offsets.back() + rest_offsets[c];
+                            ForEach(c, [&](const Edge &edge, const bool keep) {
+                                *(keep ? kept++ : rest++) = edge;
+                            });
+                        }
+                    });
+    }
+
+   private:
+    struct Chunk {
+        const Edge *threshold = nullptr;
+        const Edge *last_kept = nullptr;
+        std::uint64_t kept = 0;
+    };
+
+    [[nodiscard]] std::uint64_t Begin(const std::uint64_t c) const {
+        return c * kPresortGrainSize;
+    }
+
+    [[nodiscard]] std::uint64_t End(const std::uint64_t c) const {
+        return std::min(_size, (c + 1) * kPresortGrainSize);
+    }
+
+    template <typename Lambda>
+    void ForEach(const std::uint64_t c, Lambda &&l) const {
+        const Edge *last = _chunks[c].threshold;
+        for (std::uint64_t i = Begin(c); i < End(c); ++i) {
+            const bool keep = last == nullptr || !(_edges[i] < *last);
+            if (keep) {
+                last = _edges + i;
+            }
+            l(_edges[i], keep);
+        }
+    }
+
+    void Scan(const std::uint64_t c, const Edge *threshold) {
+        Chunk &chunk = _chunks[c];
+        chunk = {.threshold = threshold, .last_kept = nullptr, .kept = 0};
+        ForEach(c, [&](const Edge &edge, const bool keep) {
+            if (keep) {
+                chunk.last_kept = &edge;
+                ++chunk.kept;
+            }
+        });
+    }
+
+    const Edge *_edges;
+    std::uint64_t _size;
+    std::vector<Chunk> _chunks;
+};
+
+}  // namespace internal
+
+// Sorts [first, last) and exploits presorted input, such as edge lists that
+// are sorted by source or consist of a few sorted pieces:
+// - sorted input is left as is,
+// - few long natural runs are merged,
+// - if at least half of the edges form an ascending subsequence, e.g., the
+//   edges of a source-sorted list that were not swapped by canonicalization,
+//   only the others are sorted and then merged with them.
+// Everything else is sorted by ips4o. Merging needs a second buffer as large as
+// the edges; if it does not fit into the available memory, the edges are
+// sorted in place by ips4o instead.
+template <typename Iterator>
+inline void SortEdges(Iterator first, Iterator last) {
+    using Edge = typename std::iterator_traits<Iterator>::value_type;
+    constexpr std::uint64_t kGrainSize = 1ull << 16;
+
+    Edge *edges = std::to_address(first);
+    const std::uint64_t size = last - first;
+
+    auto copy = [&](const Edge *from, Edge *to) {
+        ParallelFor(0, size, kGrainSize,
+                    [&](int, const std::uint64_t begin,
+                        const std::uint64_t end) {
+                        std::copy(from + begin, from + end, to + begin);
+                    });
+    };
+
+    const std::vector<std::uint64_t> runs = internal::FindNaturalRuns(
+        edges, size,
+        std::clamp<std::uint64_t>(size / kMinNaturalRunLength, 1,
+                                  kMaxNaturalRuns));
+    if (runs.size() == 2) {
+        std::cout << "\tEdges are already sorted" << std::endl;
+        return;
+    }
+
+    // Merging leaves a tenth of the available memory to the rest of the
+    // process
+    const bool can_merge = sizeof(Edge) * size <= AvailableMemory() / 10 * 9;
+
+    if (!runs.empty() && can_merge) {
+        std::cout << "\tMerging " << runs.size() - 1 << " sorted runs"
+                  << std::endl;
+        Buffer<Edge> from(size);
+        copy(edges, from.data());
+        internal::MergeRuns(from.data(), runs, edges);
+        return;
+    }
+    if (!can_merge) {
+        if (!runs.empty()) {
+            std::cout << "\tNot enough memory to merge " << runs.size() - 1
+                      << " sorted runs, sorting in place" << std::endl;
+        }
+        ips4o::parallel::sort(first, last);
+        return;
+    }
+
+    const internal::AscendingSplit<Edge> split(edges, size);
+    const std::uint64_t kept = split.Kept();
+    if (kept < size / 2) {
+        ips4o::parallel::sort(first, last);
+        return;
+    }
+
+    std::cout << "\tSorting " << size - kept << " of " << size
+              << " edges and merging them with the presorted ones"
+              << std::endl;
+    Buffer<Edge> from(size);
+    split.Scatter(from.data());
+    ips4o::parallel::sort(from.begin() + kept, from.end());
+    internal::MergeRuns(from.data(), {0, kept, size}, edges);
+}
+
+// Sorts the edges and removes duplicates; returns the number of removed edges.
+template <typename Edges>
+inline std::uint64_t SortAndRemoveDuplicates(Edges &edges) {
+    SortEdges(edges.begin(), edges.end());
+
+    const std::uint64_t size_before = edges.size();
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+    return size_before - edges.size();
+}
+
+// Sorts the edges and collapses every run of duplicates into a single edge
+// whose weight is the length of the run (saturated to EdgeWeight); returns the
+// number of removed edges.
+template <typename Edges, typename Weights>
+inline std::uint64_t SortAndCountDuplicates(Edges &edges, Weights &weights) {
+    SortEdges(edges.begin(), edges.end());
+
+    const std::uint64_t size_before = edges.size();
+    weights.clear();
+    weights.reserve(size_before);
+
+    std::uint64_t size = 0;
+    for (std::uint64_t i = 0; i < size_before;) {
+        std::uint64_t j = i + 1;
+        while (j < size_before && edges[j] == edges[i]) {
+            ++j;
+        }
+
+        edges[size++] = edges[i];
+        weights.push_back(static_cast<EdgeWeight>(std::min<std::uint64_t>(
+            j - i, std::numeric_limits<EdgeWeight>::max())));
+        i = j;
+    }
+
+    edges.resize(size);
+    return size_before - size;
+}
+
+// Sorts the edges and permutes their weights accordingly.
+template <typename Edges, typename Weights>
+inline void SortWithWeights(Edges &edges, Weights &weights) {
+    using Entry = std::pair<typename Edges::value_type, EdgeWeight>;
+    constexpr std::uint64_t kGrainSize = 1ull << 16;
+
+    Buffer<Entry> entries(edges.size());
+    ParallelFor(0, edges.size(), kGrainSize,
+                [&](int, const std::uint64_t first, const std::uint64_t last) {
+                    for (std::uint64_t i = first; i < last; ++i) {
+                        entries[i] = {edges[i], weights[i]};
+                    }
+                });
+
+    ips4o::parallel::sort(entries.begin(), entries.end());
+
+    ParallelFor(0, edges.size(), kGrainSize,
+                [&](int, const std::uint64_t first, const std::uint64_t last) {
+                    for (std::uint64_t i = first; i < last; ++i) {
+                        edges[i] = entries[i].first;
+                        weights[i] = entries[i].second;
+                    }
+                });
+}
+
+// Sorts the edges and collapses every run of duplicates into a single edge
+// whose weight is the sum of their weights (saturated to EdgeWeight); returns
+// the number of removed edges.
+template <typename Edges, typename Weights>
+inline std::uint64_t SortAndSumDuplicates(Edges &edges, Weights &weights) {
+    SortWithWeights(edges, weights);
+
+    const std::uint64_t size_before = edges.size();
+    std::uint64_t size = 0;
+    for (std::uint64_t i = 0; i < size_before;) {
+        std::uint64_t weight = 0;
+        std::uint64_t j = i;
+        for (; j < size_before && edges[j] == edges[i]; ++j) {
+            weight += weights[j];
+        }
+
+        edges[size] = edges[i];
+        weights[size] = static_cast<EdgeWeight>(std::min<std::uint64_t>(
+            weight, std::numeric_limits<EdgeWeight>::max()));
+        ++size;
+        i = j;
+    }
+
+    edges.resize(size);
+    weights.resize(size);
+    return size_before - size;
+}
+
+// Appends the reverse of every edge and sorts the result. The edges must not
+// contain self-loops and must not contain both (u, v) and (v, u).
+template <typename Edges>
+inline void Symmetrize(Edges &edges) {
+    const std::size_t size = edges.size();
+    edges.resize(2 * size);
+    for (std::size_t i = 0; i < size; ++i) {
+        edges[size + i] = {edges[i].second, edges[i].first};
+    }
+    ips4o::parallel::sort(edges.begin(), edges.end());
+}
+
+// Writes sorted and symmetric edges as ParHiP graph; the number of vertices is
+// given by the largest source vertex.
+template <typename NodeID>
+inline parhip::Header WriteGraph(std::ofstream &out,
+                                 const std::vector<Edge<NodeID>> &edges) {
+    parhip::Header header{
+        .version =
+            {
+                .has_edge_weights = false,
+                .has_vertex_weights = false,
+                .has_32bit_edge_ids = false,
+                .has_32bit_vertex_ids = sizeof(NodeID) == 4,
+                .has_32bit_vertex_weights = false,
+                .has_32bit_edge_weights = false,
+            },
+        .n = edges.empty() ? 0 : edges.back().first + 1ull,
+        .m = edges.size(),
+    };
+
+    std::vector<parhip::ID64> xadj(header.n + 1);
+    for (const auto &[u, v] : edges) {
+        ++xadj[u];
+    }
+    parhip::DegreesToXadj(header, xadj);
+
+    parhip::WriteHeader(out, header);
+    out.write(reinterpret_cast<const char *>(xadj.data()),
+              xadj.size() * sizeof(parhip::ID64));
+
+    constexpr std::size_t buf_size = 1ull * 1024 * 1024;
+    std::vector<NodeID> adjncy;
+    adjncy.reserve(buf_size);
+    for (const auto &[u, v] : edges) {
+        adjncy.push_back(v);
+        if (adjncy.size() == buf_size) {
+            out.write(reinterpret_cast<const char *>(adjncy.data()),
+                      adjncy.size() * sizeof(NodeID));
+            adjncy.clear();
+        }
+    }
+    out.write(reinterpret_cast<const char *>(adjncy.data()),
+              adjncy.size() * sizeof(NodeID));
+
+    return header;
+}
+
+}  // namespace hyperlink
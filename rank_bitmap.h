@@ -0,0 +1,149 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <numeric>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "io.h"
+#include "parallel.h"
+#include "report.h"
+
+namespace hyperlink {
+
+// Bitmap over [0, size) with constant-time rank queries, i.e., the number of
+// set bits before a position. Bits can be set concurrently; ranks must be
+// built once all bits are set and before the first query.
+class RankBitmap {
+    static constexpr std::uint64_t kWordBits = 64;
+    static constexpr std::uint64_t kBlockWords = 8;
+
+   public:
+    explicit RankBitmap(const std::uint64_t size = 0)
+        : _size(size), _words((size + kWordBits - 1) / kWordBits) {}
+
+    [[nodiscard]] std::uint64_t Size() const { return _size; }
+
+    // Thread-safe.
+    void Set(const std::uint64_t i) {
+        std::atomic_ref<std::uint64_t>(_words[i / kWordBits])
+            .fetch_or(1ull << (i % kWordBits), std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] bool Get(const std::uint64_t i) const {
+        return (_words[i / kWordBits] >> (i % kWordBits)) & 1;
+    }
+
+    // Computes the number of set bits before every block of 512 bits in
+    // parallel.
+    void BuildRanks() {
+        const std::uint64_t num_blocks =
+            (_words.size() + kBlockWords - 1) / kBlockWords;
+        _ranks.assign(num_blocks + 1, 0);
+
+        ParallelFor(0, num_blocks, 4096,
+                    [&](int, const std::uint64_t first,
+                        const std::uint64_t last) {
+                        for (std::uint64_t b = first; b < last; ++b) {
+                            _ranks[b + 1] = CountWords(b * kBlockWords,
+                                                       (b + 1) * kBlockWords);
+                        }
+                    });
+        std::inclusive_scan(_ranks.begin(), _ranks.end(), _ranks.begin());
+    }
+
+    // Number of set bits in [0, i).
+    [[nodiscard]] std::uint64_t Rank(const std::uint64_t i) const {
+        const std::uint64_t word = i / kWordBits;
+        const std::uint64_t block = word / kBlockWords;
+        const std::uint64_t mask = (1ull << (i % kWordBits)) - 1;
+
+        std::uint64_t rank =
+            _ranks[block] + CountWords(block * kBlockWords, word);
+        if (word < _words.size()) {
+            rank += std::popcount(_words[word] & mask);
+        }
+        return rank;
+    }
+
+    // Number of set bits.
+    [[nodiscard]] std::uint64_t Count() const { return _ranks.back(); }
+
+    // Calls l(i) for every set bit in increasing order.
+    template <typename Lambda>
+    void ForEachSetBit(Lambda &&l) const {
+        for (std::uint64_t w = 0; w < _words.size(); ++w) {
+            for (std::uint64_t word = _words[w]; word != 0; word &= word - 1) {
+                l(w * kWordBits + std::countr_zero(word));
+            }
+        }
+    }
+
+   private:
+    [[nodiscard]] std::uint64_t CountWords(const std::uint64_t first,
+                                           std::uint64_t last) const {
+        last = std::min<std::uint64_t>(last, _words.size());
+
+        std::uint64_t count = 0;
+        for (std::uint64_t w = first; w < last; ++w) {
+            count += std::popcount(_words[w]);
+        }
+        return count;
+    }
+
+    std::uint64_t _size;
+    std::vector<std::uint64_t> _words;
+    std::vector<std::uint64_t> _ranks = {0};
+};
+
+// Marks every vertex ID that occurs as an endpoint of an edge in the binary
+// edge lists, scanning each file in parallel; used to relabel the vertices with
+// --compact.
+template <typename NodeID>
+RankBitmap MarkUsedIDs(const std::vector<std::string> &filenames) {
+    using Edge = std::pair<NodeID, NodeID>;
+    constexpr std::uint64_t kGrainSize = 1ull << 16;
+
+    std::vector<std::uint64_t> bounds(NumThreads());
+    for (const std::string &filename : filenames) {
+        const io::MappedFile file(filename);
+        const auto *edges = reinterpret_cast<const Edge *>(file.Data());
+
+        ParallelFor(0, file.Length() / sizeof(Edge), kGrainSize,
+                    [&](const int thread_id, const std::uint64_t first,
+                        const std::uint64_t last) {
+                        std::uint64_t bound = bounds[thread_id];
+                        for (std::uint64_t e = first; e < last; ++e) {
+                            bound = std::max<std::uint64_t>(
+                                {bound, edges[e].first + 1ull,
+                                 edges[e].second + 1ull});
+                        }
+                        bounds[thread_id] = bound;
+                    });
+    }
+
+    RankBitmap used(*std::max_element(bounds.begin(), bounds.end()));
+    for (const std::string &filename : filenames) {
+        const io::MappedFile file(filename);
+        const auto *edges = reinterpret_cast<const Edge *>(file.Data());
+
+        ParallelFor(0, file.Length() / sizeof(Edge), kGrainSize,
+                    [&](int, const std::uint64_t first,
+                        const std::uint64_t last) {
+                        for (std::uint64_t e = first; e < last; ++e) {
+                            used.Set(edges[e].first);
+                            used.Set(edges[e].second);
+                        }
+                    });
+        report::AddBytesRead(2 * file.Length());
+    }
+
+    used.BuildRanks();
+    return used;
+}
+
+}  // namespace hyperlink
@@ -0,0 +1,232 @@
+#pragma once
+
+#include <sys/resource.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "flags.h"
+
+namespace hyperlink::report {
+
+// Collects per-phase timings, I/O volume, processed edges and resource usage
+// of a tool. If the tool is invoked with --report=<file.json>, the report is
+// written to that file when the process exits.
+class Report {
+    using Clock = std::chrono::steady_clock;
+
+   public:
+    static Report &Get() {
+        static Report report;
+        return report;
+    }
+
+    // Removes --report=<file> or --report <file> from the command line and
+    // remembers the tool invocation.
+    void Init(int &argc, const char *argv[]) {
+        _filename = ExtractFlag(argc, argv, "report");
+        _args.assign(argv, argv + argc);
+    }
+
+    void AddBytesRead(const std::uint64_t bytes) {
+        _bytes_read.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    void AddBytesWritten(const std::uint64_t bytes) {
+        _bytes_written.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    void AddEdges(const std::uint64_t edges) {
+        _edges.fetch_add(edges, std::memory_order_relaxed);
+    }
+
+    // Records a property of the run, e.g., how memory was placed; must only
+    // be called by the main thread.
+    void SetProperty(const std::string &key, const std::string &value) {
+        for (auto &[existing_key, existing_value] : _properties) {
+            if (existing_key == key) {
+                existing_value = value;
+                return;
+            }
+        }
+        _properties.emplace_back(key, value);
+    }
+
+    ~Report() {
+        if (_filename.empty()) {
+            return;
+        }
+
+        std::ofstream out(_filename, std::ios::trunc);
+        if (!out) {
+            std::cerr << "warning: cannot write report to " << _filename
+                      << "\n";
+            return;
+        }
+
+        const Snapshot total = Now();
+        out << "{\n  \"tool\": ";
+        WriteString(out, _args.empty() ? "" : _args.front());
+        out << ",\n  \"args\": [";
+        for (std::size_t i = 1; i < _args.size(); ++i) {
+            out << (i > 1 ? ", " : "");
+            WriteString(out, _args[i]);
+        }
+        out << "],\n  \"properties\": {";
+        for (std::size_t i = 0; i < _properties.size(); ++i) {
+            out << (i > 0 ? ", " : "");
+            WriteString(out, _properties[i].first);
+            out << ": ";
+            WriteString(out, _properties[i].second);
+        }
+        out << "},\n  \"total\": ";
+        WriteMeasurement(out, _start, total);
+        out << ",\n  \"phases\": [";
+        for (std::size_t i = 0; i < _phases.size(); ++i) {
+            // Phases are still open if the tool exited early
+            const Phase &phase = _phases[i];
+            const bool complete = phase.end.time != Clock::time_point{};
+
+            out << (i > 0 ? ",\n" : "\n") << "    {\"name\": ";
+            WriteString(out, phase.name);
+            out << ", \"depth\": " << phase.depth
+                << ", \"complete\": " << (complete ? "true" : "false") << ", ";
+            WriteMeasurement(out, phase.start, complete ? phase.end : total,
+                             false);
+            out << "}";
+        }
+        out << "\n  ]\n}\n";
+    }
+
+   private:
+    friend class ScopedPhase;
+
+    struct Snapshot {
+        Clock::time_point time;
+        std::uint64_t bytes_read;
+        std::uint64_t bytes_written;
+        std::uint64_t edges;
+        std::uint64_t minor_faults;
+        std::uint64_t major_faults;
+        std::uint64_t peak_rss;
+    };
+
+    struct Phase {
+        std::string name;
+        int depth;
+        Snapshot start;
+        Snapshot end;
+    };
+
+    Report() : _start(Now()) {}
+
+    Snapshot Now() const {
+        struct rusage usage {};
+        getrusage(RUSAGE_SELF, &usage);
+
+        return {
+            .time = Clock::now(),
+            .bytes_read = _bytes_read.load(std::memory_order_relaxed),
+            .bytes_written = _bytes_written.load(std::memory_order_relaxed),
+            .edges = _edges.load(std::memory_order_relaxed),
+            .minor_faults = static_cast<std::uint64_t>(usage.ru_minflt),
+            .major_faults = static_cast<std::uint64_t>(usage.ru_majflt),
+            .peak_rss = static_cast<std::uint64_t>(usage.ru_maxrss) * 1024,
+        };
+    }
+
+    static void WriteString(std::ostream &out, const std::string &str) {
+        out << '"';
+        for (const char ch : str) {
+            if (ch == '"' || ch == '\\') {
+                out << '\\' << ch;
+            } else if (static_cast<unsigned char>(ch) < 0x20) {
+                out << ' ';
+            } else {
+                out << ch;
+            }
+        }
+        out << '"';
+    }
+
+    static void WriteMeasurement(std::ostream &out, const Snapshot &from,
+                                 const Snapshot &to, const bool braces = true) {
+        const double seconds =
+            std::chrono::duration<double>(to.time - from.time).count();
+
+        out << (braces ? "{" : "") << "\"wall_time_s\": " << seconds
+            << ", \"bytes_read\": " << to.bytes_read - from.bytes_read
+            << ", \"bytes_written\": " << to.bytes_written - from.bytes_written
+            << ", \"edges\": " << to.edges - from.edges
+            << ", \"minor_faults\": " << to.minor_faults - from.minor_faults
+            << ", \"major_faults\": " << to.major_faults - from.major_faults
+            << ", \"peak_rss_bytes\": " << to.peak_rss << (braces ? "}" : "");
+    }
+
+    std::string _filename;
+    std::vector<std::string> _args;
+    std::vector<std::pair<std::string, std::string>> _properties;
+
+    std::atomic<std::uint64_t> _bytes_read = 0;
+    std::atomic<std::uint64_t> _bytes_written = 0;
+    std::atomic<std::uint64_t> _edges = 0;
+
+    Snapshot _start;
+    std::vector<Phase> _phases;
+    int _depth = 0;
+};
+
+// Measures the enclosing scope as one phase of the report. Phases can be
+// nested, but must only be opened by the main thread.
+class ScopedPhase {
+   public:
+    explicit ScopedPhase(std::string name) : _report(Report::Get()) {
+        _index = _report._phases.size();
+        _report._phases.push_back({
+            .name = std::move(name),
+            .depth = _report._depth++,
+            .start = _report.Now(),
+            .end = {},
+        });
+    }
+
+    ScopedPhase(const ScopedPhase &) = delete;
+    ScopedPhase &operator=(const ScopedPhase &) = delete;
+
+    ~ScopedPhase() {
+        _report._phases[_index].end = _report.Now();
+        --_report._depth;
+    }
+
+   private:
+    Report &_report;
+    std::size_t _index;
+};
+
+inline void Init(int &argc, const char *argv[]) {
+    Report::Get().Init(argc, argv);
+}
+
+inline void AddBytesRead(const std::uint64_t bytes) {
+    Report::Get().AddBytesRead(bytes);
+}
+
+inline void AddBytesWritten(const std::uint64_t bytes) {
+    Report::Get().AddBytesWritten(bytes);
+}
+
+inline void AddEdges(const std::uint64_t edges) {
+    Report::Get().AddEdges(edges);
+}
+
+inline void SetProperty(const std::string &key, const std::string &value) {
+    Report::Get().SetProperty(key, value);
+}
+
+}  // namespace hyperlink::report
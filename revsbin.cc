@@ -1,21 +1,35 @@
 #include <algorithm>
 #include <cstdint>
+#include <exception>
 #include <fstream>
 #include <iostream>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "allocator.h"
+#include "checksum.h"
+#include "flags.h"
+#include "io.h"
 #include "ips4o.hpp"
+#include "pipeline.h"
+#include "report.h"
 #include "toker.h"
 
 using namespace hyperlink;
 
 using NodeID = std::uint32_t;
 
-int main(const int argc, const char *argv[]) {
+int main(int argc, const char *argv[]) {
+    report::Init(argc, argv);
+    const bool direct = ExtractSwitch(argc, argv, "direct");
+    const bool weighted = ExtractSwitch(argc, argv, "weights");
+
     if (argc != 3) {
-        std::cerr << "usage: ./revsbin <input.bin> <output.bin>\n";
+        std::cerr << "usage: ./revsbin [--direct] [--weights] <input.bin> "
+                     "<output.bin>\n";
+        std::cerr << "With --weights, <input.bin>.weights is permuted along "
+                     "with the edges and written to <output.bin>.weights.\n";
         std::exit(1);
     }
 
@@ -42,28 +56,75 @@ int main(const int argc, const char *argv[]) {
     std::cout << "Preallocating " << file_size / 1024 / 1024 / 1024
               << " GB for " << num_edges << " edges ..." << std::endl;
 
-    std::vector<std::pair<NodeID, NodeID>> edges(num_edges);
-
-    std::cout << "Reading input file ..." << std::endl;
-    in.read(reinterpret_cast<char *>(edges.data()), file_size);
+    Buffer<std::pair<NodeID, NodeID>> edges(num_edges);
+    Buffer<EdgeWeight> weights(weighted ? num_edges : 0);
 
-    std::cout << "Reversing edges ..." << std::endl;
-    for (std::pair<NodeID, NodeID> &edge : edges) {
-        std::swap(edge.first, edge.second);
+    {
+        report::ScopedPhase phase("read");
+        std::cout << "Reading input file ..." << std::endl;
+        try {
+            io::ParallelRead(input_filename, edges.data(), file_size, direct);
+            if (weighted) {
+                io::ParallelRead(WeightsFilename(input_filename),
+                                 weights.data(),
+                                 sizeof(EdgeWeight) * num_edges, direct);
+            }
+        } catch (const std::exception &e) {
+            std::cerr << "error: " << e.what() << "\n";
+            std::exit(1);
+        }
+        report::AddBytesRead(file_size + sizeof(EdgeWeight) * weights.size());
+        report::AddEdges(num_edges);
     }
+    numa::ReportPlacement("edges", edges.data(), file_size);
+    huge_pages::ReportCoverage("edges", edges.data(), file_size);
 
-    std::cout << "Sorting edges ..." << std::endl;
-    ips4o::parallel::sort(edges.begin(), edges.end());
+    {
+        report::ScopedPhase phase("reverse");
+        std::cout << "Reversing edges ..." << std::endl;
+        for (std::pair<NodeID, NodeID> &edge : edges) {
+            std::swap(edge.first, edge.second);
+        }
+        report::AddEdges(num_edges);
+    }
 
-    std::cout << "Writing output file ..." << std::endl;
-    std::ofstream out(output_filename, std::ios::binary | std::ios::trunc);
-    if (!out) {
-        std::cerr << "error: could not open output file\n";
-        std::exit(1);
+    {
+        report::ScopedPhase phase("sort");
+        std::cout << "Sorting edges ..." << std::endl;
+        if (weighted) {
+            SortWithWeights(edges, weights);
+        } else {
+            ips4o::parallel::sort(edges.begin(), edges.end());
+        }
+        report::AddEdges(num_edges);
     }
 
-    out.write(reinterpret_cast<const char *>(edges.data()),
-              sizeof(std::pair<NodeID, NodeID>) * edges.size());
+    {
+        report::ScopedPhase phase("write");
+        std::cout << "Writing output file ..." << std::endl;
+        try {
+            io::ParallelWrite(output_filename, edges.data(),
+                              sizeof(std::pair<NodeID, NodeID>) * edges.size(),
+                              direct);
+            checksum::WriteSidecar(
+                output_filename, edges.data(),
+                sizeof(std::pair<NodeID, NodeID>) * edges.size());
+            if (weighted) {
+                io::ParallelWrite(WeightsFilename(output_filename),
+                                  weights.data(),
+                                  sizeof(EdgeWeight) * weights.size(), direct);
+                checksum::WriteSidecar(WeightsFilename(output_filename),
+                                       weights.data(),
+                                       sizeof(EdgeWeight) * weights.size());
+            }
+        } catch (const std::exception &e) {
+            std::cerr << "error: " << e.what() << "\n";
+            std::exit(1);
+        }
+        report::AddBytesWritten(file_size +
+                                sizeof(EdgeWeight) * weights.size());
+        report::AddEdges(num_edges);
+    }
 
     std::cout << "Done." << std::endl;
 }
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "parallel.h"
+
+namespace hyperlink::rmat {
+
+struct Parameters {
+    int scale = 20;
+    std::uint64_t num_edges = 16ull << 20;
+    double a = 0.57;
+    double b = 0.19;
+    double c = 0.19;
+    std::uint64_t seed = 1;
+};
+
+constexpr std::uint64_t kChunkSize = 1ull << 20;
+
+inline std::uint64_t SplitMix64(std::uint64_t &state) {
+    std::uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+// Bijection on [0, 2^scale) that spreads the high-degree vertices of R-MAT
+// (which all have small IDs) over the ID space.
+inline std::uint64_t Scramble(std::uint64_t x, const int scale,
+                              const std::uint64_t seed) {
+    const std::uint64_t mask = scale >= 64 ? ~0ull : (1ull << scale) - 1ull;
+    const int shift = std::max(1, scale / 2);
+
+    x = (x ^ seed) & mask;
+    x = (x * 0x9e3779b97f4a7c15ull) & mask;
+    x ^= x >> shift;
+    x = (x * 0xbf58476d1ce4e5b9ull) & mask;
+    x ^= x >> shift;
+    return x;
+}
+
+// Calls l(u, v) for the edges [first, last) of the graph. The i-th edge only
+// depends on i and the seed, thus the graph does not depend on the number of
+// threads.
+template <typename Lambda>
+inline void GenerateEdges(const Parameters &p, const std::uint64_t first,
+                          const std::uint64_t last, Lambda &&l) {
+    constexpr double kMax = 18446744073709551616.0;  // 2^64
+    const auto threshold_a = static_cast<std::uint64_t>(p.a * kMax);
+    const auto threshold_ab = static_cast<std::uint64_t>((p.a + p.b) * kMax);
+    const auto threshold_abc =
+        static_cast<std::uint64_t>((p.a + p.b + p.c) * kMax);
+
+    for (std::uint64_t i = first; i < last; ++i) {
+        std::uint64_t state = p.seed * 0xd1342543de82ef95ull + i;
+        state = SplitMix64(state);
+
+        std::uint64_t u = 0;
+        std::uint64_t v = 0;
+        for (int level = 0; level < p.scale; ++level) {
+            const std::uint64_t r = SplitMix64(state);
+            u = (u << 1) | static_cast<std::uint64_t>(r >= threshold_ab);
+            v = (v << 1) | static_cast<std::uint64_t>(
+                               (r >= threshold_a && r < threshold_ab) ||
+                               r >= threshold_abc);
+        }
+
+        l(Scramble(u, p.scale, p.seed), Scramble(v, p.scale, p.seed));
+    }
+}
+
+// Generates all edges in parallel and stores them in edges[]; edges are stored
+// as generated, i.e., they are neither sorted nor deduplicated.
+template <typename NodeID>
+inline void GenerateEdgeList(const Parameters &p,
+                             std::vector<std::pair<NodeID, NodeID>> &edges) {
+    edges.resize(p.num_edges);
+
+    auto generate_chunk = [&](int, const std::uint64_t first,
+                              const std::uint64_t last) {
+        std::uint64_t i = first;
+        GenerateEdges(p, first, last,
+                      [&](const std::uint64_t u, const std::uint64_t v) {
+                          edges[i++] = {static_cast<NodeID>(u),
+                                        static_cast<NodeID>(v)};
+                      });
+    };
+    ParallelFor(0, p.num_edges, kChunkSize, generate_chunk);
+}
+
+inline char *FormatUInt(char *out, std::uint64_t value) {
+    char rev_buffer[20];
+    int pos = 0;
+    do {
+        rev_buffer[pos++] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+
+    while (pos > 0) {
+        *out++ = rev_buffer[--pos];
+    }
+    return out;
+}
+
+// Writes the edges as "u v" lines. Chunks are formatted in parallel and
+// written in order, one round of NumThreads() chunks at a time.
+inline std::uint64_t WriteTextEdgeList(const Parameters &p,
+                                       const std::string &filename) {
+    using namespace std::literals;
+
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("cannot write to "s + filename);
+    }
+
+    const int num_threads = NumThreads();
+    std::vector<std::vector<char>> buffers(num_threads);
+    std::uint64_t bytes_written = 0;
+
+    for (std::uint64_t round = 0; round < p.num_edges;
+         round += num_threads * kChunkSize) {
+        ParallelInvoke([&](const int thread_id) {
+            const std::uint64_t first =
+                std::min(p.num_edges, round + thread_id * kChunkSize);
+            const std::uint64_t last =
+                std::min(p.num_edges, first + kChunkSize);
+
+            std::vector<char> &buffer = buffers[thread_id];
+            buffer.resize((last - first) * 42);
+
+            char *pos = buffer.data();
+            GenerateEdges(p, first, last,
+                          [&](const std::uint64_t u, const std::uint64_t v) {
+                              pos = FormatUInt(pos, u);
+                              *pos++ = ' ';
+                              pos = FormatUInt(pos, v);
+                              *pos++ = '\n';
+                          });
+            buffer.resize(pos - buffer.data());
+        });
+
+        for (const std::vector<char> &buffer : buffers) {
+            out.write(buffer.data(), buffer.size());
+            bytes_written += buffer.size();
+        }
+    }
+
+    return bytes_written;
+}
+
+}  // namespace hyperlink::rmat
@@ -0,0 +1,110 @@
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "pipeline.h"
+#include "report.h"
+#include "rmat.h"
+
+using namespace hyperlink;
+
+// Generates the edges, canonicalizes them as txt2sbin does and returns them
+// sorted and without duplicates or self-loops.
+template <typename NodeID>
+std::vector<Edge<NodeID>> GenerateCanonicalEdges(const rmat::Parameters &p) {
+    std::vector<Edge<NodeID>> edges;
+    rmat::GenerateEdgeList(p, edges);
+
+    std::size_t size = 0;
+    for (const auto &[u, v] : edges) {
+        if (u != v) {
+            edges[size++] = {std::min(u, v), std::max(u, v)};
+        }
+    }
+    edges.resize(size);
+
+    SortAndRemoveDuplicates(edges);
+    return edges;
+}
+
+template <typename NodeID>
+void WriteBinary(const rmat::Parameters &p, const std::string &filename) {
+    const std::vector<Edge<NodeID>> edges = GenerateCanonicalEdges<NodeID>(p);
+
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char *>(edges.data()),
+              sizeof(Edge<NodeID>) * edges.size());
+    report::AddBytesWritten(sizeof(Edge<NodeID>) * edges.size());
+    std::cout << "\tEdges: " << edges.size() << std::endl;
+}
+
+void WriteParhip(const rmat::Parameters &p, const std::string &filename) {
+    std::vector<Edge<std::uint32_t>> edges =
+        GenerateCanonicalEdges<std::uint32_t>(p);
+    Symmetrize(edges);
+
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    const parhip::Header header = WriteGraph(out, edges);
+    report::AddBytesWritten(parhip::GraphSize(header));
+    std::cout << "\tNumber of vertices: " << header.n << std::endl;
+    std::cout << "\tNumber of edges: " << header.m << std::endl;
+}
+
+int main(int argc, const char *argv[]) {
+    report::Init(argc, argv);
+
+    if (argc < 5) {
+        std::cerr << "usage: ./rmatgen <scale> <edge factor> "
+                     "<txt|bin32|bin64|parhip> <output> [<seed>]\n";
+        std::exit(1);
+    }
+
+    rmat::Parameters p;
+    p.scale = std::stoi(argv[1]);
+    p.num_edges = std::stoull(argv[2]) << p.scale;
+    const std::string format = argv[3];
+    const std::string output_filename = argv[4];
+    if (argc > 5) {
+        p.seed = std::stoull(argv[5]);
+    }
+
+    if (p.scale < 1 || p.scale > 63 ||
+        (p.scale > 32 && format != "txt" && format != "bin64")) {
+        std::cerr << "error: scale not supported by output format\n";
+        std::exit(1);
+    }
+
+    std::cout << "Generating R-MAT graph with 2^" << p.scale << " vertices and "
+              << p.num_edges << " edges (a=" << p.a << ", b=" << p.b
+              << ", c=" << p.c << ", seed=" << p.seed << ") ..." << std::endl;
+    std::cout << "Out(" << format << "): " << output_filename << std::endl;
+
+    try {
+        report::ScopedPhase phase("generate");
+        report::AddEdges(p.num_edges);
+        if (format == "txt") {
+            const std::uint64_t bytes =
+                rmat::WriteTextEdgeList(p, output_filename);
+            std::cout << "\tSize: " << bytes << " bytes" << std::endl;
+            report::AddBytesWritten(bytes);
+        } else if (format == "bin32") {
+            WriteBinary<std::uint32_t>(p, output_filename);
+        } else if (format == "bin64") {
+            WriteBinary<std::uint64_t>(p, output_filename);
+        } else if (format == "parhip") {
+            WriteParhip(p, output_filename);
+        } else {
+            std::cerr << "error: unknown output format " << format << "\n";
+            std::exit(1);
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "error: " << e.what() << "\n";
+        std::exit(1);
+    }
+
+    std::cout << "Done." << std::endl;
+}
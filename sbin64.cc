@@ -1,25 +1,34 @@
 #include <algorithm>
 #include <cstdint>
+#include <exception>
 #include <fstream>
 #include <iostream>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "allocator.h"
+#include "checksum.h"
+#include "flags.h"
+#include "io.h"
 #include "ips4o.hpp"
+#include "report.h"
 #include "toker.h"
 
 using namespace hyperlink;
 
 using NodeID = std::uint64_t;
 
-int main(const int argc, const char *argv[]) {
+int main(int argc, const char *argv[]) {
+    report::Init(argc, argv);
+    const bool direct = ExtractSwitch(argc, argv, "direct");
+
     if (argc < 2) {
-        std::cerr << "usage: ./sbin64 <files>\n";
+        std::cerr << "usage: ./sbin64 [--direct] <files>\n";
         std::exit(1);
     }
 
-    std::vector<std::pair<NodeID, NodeID>> edges(0);
+    Buffer<std::pair<NodeID, NodeID>> edges(0);
         
     for (std::size_t i = 1; i < argc; ++i) {
         const std::string io_filename = argv[i];
@@ -43,23 +52,48 @@ int main(const int argc, const char *argv[]) {
         edges.resize(num_edges);
 
 
-        std::cout << io_filename << ": reading input file ..." << std::endl;
-        in.read(reinterpret_cast<char *>(edges.data()), file_size);
-        in.close();
-
-        std::cout << io_filename << ": sorting edges ..." << std::endl;
-        ips4o::parallel::sort(edges.begin(), edges.end());
+        {
+            report::ScopedPhase phase("read " + io_filename);
+            std::cout << io_filename << ": reading input file ..."
+                      << std::endl;
+            in.close();
+            try {
+                io::ParallelRead(io_filename, edges.data(), file_size, direct);
+            } catch (const std::exception &e) {
+                std::cerr << "error: " << e.what() << "\n";
+                std::exit(1);
+            }
+            report::AddBytesRead(file_size);
+            report::AddEdges(num_edges);
+        }
+        numa::ReportPlacement("edges", edges.data(), file_size);
+        huge_pages::ReportCoverage("edges", edges.data(), file_size);
 
-        std::cout << io_filename << ": writing output file ..." << std::endl;
-        std::ofstream out(io_filename, std::ios::binary | std::ios::trunc);
-        if (!out) {
-            std::cerr << "error: cannot write to " << io_filename << "\n";
-            std::exit(1);
+        {
+            report::ScopedPhase phase("sort " + io_filename);
+            std::cout << io_filename << ": sorting edges ..." << std::endl;
+            ips4o::parallel::sort(edges.begin(), edges.end());
+            report::AddEdges(num_edges);
         }
 
-        out.write(reinterpret_cast<const char *>(edges.data()),
-                  sizeof(std::pair<NodeID, NodeID>) * edges.size());
-        out.close();
+        {
+            report::ScopedPhase phase("write " + io_filename);
+            std::cout << io_filename << ": writing output file ..."
+                      << std::endl;
+            try {
+                io::ParallelWrite(
+                    io_filename, edges.data(),
+                    sizeof(std::pair<NodeID, NodeID>) * edges.size(), direct);
+                checksum::WriteSidecar(
+                    io_filename, edges.data(),
+                    sizeof(std::pair<NodeID, NodeID>) * edges.size());
+            } catch (const std::exception &e) {
+                std::cerr << "error: " << e.what() << "\n";
+                std::exit(1);
+            }
+            report::AddBytesWritten(file_size);
+            report::AddEdges(num_edges);
+        }
     }
 
     std::cout << "Done." << std::endl;
@@ -0,0 +1,218 @@
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#include "flags.h"
+#include "io.h"
+#include "parallel.h"
+#include "report.h"
+
+using namespace hyperlink;
+
+// Edges per chunk; small enough that the run-length pass over a chunk hits the
+// cache after the comparison pass.
+constexpr std::uint64_t kGrainSize = 1ull << 16;
+constexpr int kHistogramBins = 64;
+
+struct Stats {
+    std::uint64_t unsorted = 0;
+    std::uint64_t duplicates = 0;
+    std::uint64_t self_loops = 0;
+    std::uint64_t max_vertex = 0;
+    std::uint64_t sources = 0;
+
+    // histogram[i] counts sources with out-degree in [2^i, 2^(i + 1))
+    std::vector<std::uint64_t> histogram =
+        std::vector<std::uint64_t>(kHistogramBins);
+
+    void Merge(const Stats &other) {
+        unsorted += other.unsorted;
+        duplicates += other.duplicates;
+        self_loops += other.self_loops;
+        max_vertex = std::max(max_vertex, other.max_vertex);
+        sources += other.sources;
+        for (int i = 0; i < kHistogramBins; ++i) {
+            histogram[i] += other.histogram[i];
+        }
+    }
+};
+
+// Compares every edge in [begin, end) with its predecessor, which may belong
+// to the previous chunk.
+template <typename NodeID>
+void CompareEdges(const std::pair<NodeID, NodeID> *edges, std::uint64_t begin,
+                  const std::uint64_t end, Stats &stats) {
+    auto compare = [&](const std::uint64_t i) {
+        const auto &[u, v] = edges[i];
+        if (i > 0) {
+            stats.unsorted += edges[i] < edges[i - 1];
+            stats.duplicates += edges[i] == edges[i - 1];
+        }
+        stats.self_loops += u == v;
+        stats.max_vertex =
+            std::max<std::uint64_t>(stats.max_vertex, std::max(u, v));
+    };
+
+#ifdef __AVX2__
+    if constexpr (sizeof(NodeID) == 4) {
+        // Every edge is loaded as one 64 bit lane (v << 32 | u); swapping the
+        // 32 bit halves yields the key (u << 32 | v), whose order is the
+        // lexicographic order of the edges. AVX2 only compares signed 64 bit
+        // integers, thus the keys are biased by 2^63.
+        const __m256i bias = _mm256_set1_epi64x(1ull << 63);
+        __m256i max = _mm256_setzero_si256();
+
+        if (begin == 0 && begin < end) {
+            compare(begin++);
+        }
+        for (; begin + 4 <= end; begin += 4) {
+            const __m256i cur = _mm256_loadu_si256(
+                reinterpret_cast<const __m256i *>(edges + begin));
+            const __m256i prev = _mm256_loadu_si256(
+                reinterpret_cast<const __m256i *>(edges + begin - 1));
+            const __m256i cur_swapped =
+                _mm256_shuffle_epi32(cur, _MM_SHUFFLE(2, 3, 0, 1));
+            const __m256i prev_swapped =
+                _mm256_shuffle_epi32(prev, _MM_SHUFFLE(2, 3, 0, 1));
+
+            const __m256i unsorted =
+                _mm256_cmpgt_epi64(_mm256_xor_si256(prev_swapped, bias),
+                                   _mm256_xor_si256(cur_swapped, bias));
+            const __m256i duplicates = _mm256_cmpeq_epi64(cur, prev);
+            const __m256i self_loops = _mm256_cmpeq_epi64(cur, cur_swapped);
+
+            stats.unsorted += std::popcount(static_cast<unsigned>(
+                _mm256_movemask_pd(_mm256_castsi256_pd(unsorted))));
+            stats.duplicates += std::popcount(static_cast<unsigned>(
+                _mm256_movemask_pd(_mm256_castsi256_pd(duplicates))));
+            stats.self_loops += std::popcount(static_cast<unsigned>(
+                _mm256_movemask_pd(_mm256_castsi256_pd(self_loops))));
+            max = _mm256_max_epu32(max, cur);
+        }
+
+        alignas(32) std::uint32_t lanes[8];
+        _mm256_store_si256(reinterpret_cast<__m256i *>(lanes), max);
+        for (const std::uint32_t lane : lanes) {
+            stats.max_vertex = std::max<std::uint64_t>(stats.max_vertex, lane);
+        }
+    }
+#endif
+
+    for (; begin < end; ++begin) {
+        compare(begin);
+    }
+}
+
+// Counts the out-degree of every source whose run of edges starts in
+// [begin, end); runs may extend into the following chunks. Only meaningful if
+// the edges are sorted.
+template <typename NodeID>
+void CountDegrees(const std::pair<NodeID, NodeID> *edges,
+                  const std::uint64_t num_edges, const std::uint64_t begin,
+                  const std::uint64_t end, Stats &stats) {
+    for (std::uint64_t i = begin; i < end; ++i) {
+        if (i > 0 && edges[i].first == edges[i - 1].first) {
+            continue;
+        }
+
+        std::uint64_t j = i + 1;
+        while (j < num_edges && edges[j].first == edges[i].first) {
+            ++j;
+        }
+        ++stats.sources;
+        ++stats.histogram[std::bit_width(j - i) - 1];
+        i = j - 1;
+    }
+}
+
+template <typename NodeID>
+Stats Inspect(const io::MappedFile &file) {
+    using Edge = std::pair<NodeID, NodeID>;
+
+    const auto *edges = reinterpret_cast<const Edge *>(file.Data());
+    const std::uint64_t num_edges = file.Length() / sizeof(Edge);
+
+    std::vector<Stats> stats(NumThreads());
+    auto inspect_chunk = [&](const int thread_id, const std::uint64_t begin,
+                             const std::uint64_t end) {
+        CompareEdges(edges, begin, end, stats[thread_id]);
+        CountDegrees(edges, num_edges, begin, end, stats[thread_id]);
+    };
+    ParallelFor(0, num_edges, kGrainSize, inspect_chunk);
+
+    for (std::size_t t = 1; t < stats.size(); ++t) {
+        stats.front().Merge(stats[t]);
+    }
+    return stats.front();
+}
+
+int main(int argc, const char *argv[]) {
+    report::Init(argc, argv);
+    const bool wide = ExtractSwitch(argc, argv, "64");
+
+    if (argc != 2) {
+        std::cerr << "usage: ./statsbin [--64] <input.bin>\n";
+        std::exit(1);
+    }
+
+    const std::string input_filename = argv[1];
+    const std::size_t edge_size = wide ? 16 : 8;
+
+    try {
+        const io::MappedFile file(input_filename);
+        const std::uint64_t num_edges = file.Length() / edge_size;
+
+        std::cout << "In(bin" << (wide ? 64 : 32) << "): " << input_filename
+                  << std::endl;
+        if (file.Length() % edge_size != 0) {
+            std::cout << "\tWarning: file size is not a multiple of "
+                      << edge_size << " bytes, ignoring trailing data"
+                      << std::endl;
+        }
+
+        Stats stats;
+        {
+            report::ScopedPhase phase("inspect");
+            stats = wide ? Inspect<std::uint64_t>(file)
+                         : Inspect<std::uint32_t>(file);
+            report::AddBytesRead(file.Length());
+            report::AddEdges(num_edges);
+        }
+
+        std::cout << "Edges:       " << num_edges << "\n";
+        std::cout << "Unsorted:    " << stats.unsorted << "\n";
+        std::cout << "Duplicates:  " << stats.duplicates << "\n";
+        std::cout << "Self-loops:  " << stats.self_loops << "\n";
+        std::cout << "Max vertex:  " << stats.max_vertex << "\n";
+
+        if (stats.unsorted == 0) {
+            std::cout << "Sources:     " << stats.sources << "\n";
+            std::cout << "Out-degree histogram:\n";
+            for (int i = 0; i < kHistogramBins; ++i) {
+                if (stats.histogram[i] > 0) {
+                    std::cout << "\t[" << (1ull << i) << ", "
+                              << (1ull << i) * 2 - 1
+                              << "]: " << stats.histogram[i] << "\n";
+                }
+            }
+        }
+
+        const bool ok = stats.unsorted == 0 && stats.duplicates == 0;
+        std::cout << (ok ? "OK." : "FAILED.") << std::endl;
+        if (!ok) {
+            std::exit(1);
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "error: " << e.what() << "\n";
+        std::exit(1);
+    }
+}
@@ -5,13 +5,96 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <cassert>
 #include <cctype>
 #include <cstdint>
 #include <string>
 
+#include "allocator.h"
+
 namespace hyperlink {
 
+// What to do with the columns after the second one of an edge list.
+enum class Columns { kNone, kSkip, kWeight };
+
+// Syntax of a text edge list with one edge per line. The tokenizer is
+// specialized for every dialect at compile time, so that PlainDialect keeps its
+// tight loop.
+template <bool comments, bool commas, Columns columns, bool one_based>
+struct Dialect {
+    // Lines starting with '#' or '%' are skipped, e.g., SNAP and KONECT
+    // headers.
+    static constexpr bool kComments = comments;
+    // Columns are separated by commas or whitespace.
+    static constexpr bool kCommas = commas;
+    // Lines may have further columns; with kWeight, the third one is the
+    // weight of the edge.
+    static constexpr Columns kColumns = columns;
+    // Vertex IDs start at 1.
+    static constexpr bool kOneBased = one_based;
+
+    static constexpr bool kPlain =
+        !comments && !commas && columns == Columns::kNone && !one_based;
+};
+
+// Whitespace-separated, 0-based vertex IDs and nothing else.
+using PlainDialect = Dialect<false, false, Columns::kNone, false>;
+
+struct DialectOptions {
+    bool comments = false;
+    bool commas = false;
+    Columns columns = Columns::kNone;
+    bool one_based = false;
+};
+
+namespace internal {
+
+template <bool comments, bool commas, Columns columns, typename Lambda>
+inline void VisitOneBased(const DialectOptions &options, Lambda &&l) {
+    if (options.one_based) {
+        l(Dialect<comments, commas, columns, true>{});
+    } else {
+        l(Dialect<comments, commas, columns, false>{});
+    }
+}
+
+template <bool comments, bool commas, typename Lambda>
+inline void VisitColumns(const DialectOptions &options, Lambda &&l) {
+    switch (options.columns) {
+        case Columns::kNone:
+            VisitOneBased<comments, commas, Columns::kNone>(options, l);
+            break;
+        case Columns::kSkip:
+            VisitOneBased<comments, commas, Columns::kSkip>(options, l);
+            break;
+        case Columns::kWeight:
+            VisitOneBased<comments, commas, Columns::kWeight>(options, l);
+            break;
+    }
+}
+
+template <bool comments, typename Lambda>
+inline void VisitCommas(const DialectOptions &options, Lambda &&l) {
+    if (options.commas) {
+        VisitColumns<comments, true>(options, l);
+    } else {
+        VisitColumns<comments, false>(options, l);
+    }
+}
+
+}  // namespace internal
+
+// Calls l(Dialect<...>{}) with the dialect described by the options.
+template <typename Lambda>
+inline void VisitDialect(const DialectOptions &options, Lambda &&l) {
+    if (options.comments) {
+        internal::VisitCommas<true>(options, l);
+    } else {
+        internal::VisitCommas<false>(options, l);
+    }
+}
+
 class MappedFileToker {
    public:
     explicit MappedFileToker(const std::string &filename) {
@@ -24,10 +107,12 @@ class MappedFileToker {
 
         _position = 0;
         _length = static_cast<std::size_t>(file_info.st_size);
+        _end = _length;
 
         _contents = static_cast<char *>(
             mmap(nullptr, _length, PROT_READ, MAP_PRIVATE, _fd, 0));
         assert(_contents != MAP_FAILED && "mmap() failed");
+        huge_pages::AdviseFileMapping(_contents, _length, true);
     }
 
     ~MappedFileToker() {
@@ -69,22 +154,104 @@ class MappedFileToker {
         SkipSpaces();
     }
 
+    // Skips whitespace and, if the dialect has them, comment lines, i.e.,
+    // moves to the start of the next edge.
+    template <typename Dialect>
+    inline void SkipToEdge() {
+        SkipSpaces();
+        if constexpr (Dialect::kComments) {
+            while (ValidPosition() && (Current() == '#' || Current() == '%')) {
+                SkipLine();
+                SkipSpaces();
+            }
+        }
+    }
+
+    // Scans the edge at the current position and moves to the next one.
+    // `weight` is only set for Columns::kWeight. Returns false if the line
+    // does not match the dialect; the position is then undefined.
+    template <typename Dialect>
+    inline bool ScanEdge(std::uint64_t &u, std::uint64_t &v,
+                         std::uint64_t &weight) {
+        if constexpr (Dialect::kPlain) {
+            // Only guards against tokens that are not numbers, which would
+            // otherwise never be consumed
+            const std::size_t position = _position;
+            u = ScanUInt();
+            v = ScanUInt();
+            return _position != position;
+        } else {
+            if (!ScanColumn<Dialect>(u) || !ScanColumn<Dialect>(v)) {
+                return false;
+            }
+            if constexpr (Dialect::kColumns == Columns::kWeight) {
+                if (!ScanColumn<Dialect>(weight)) {
+                    return false;
+                }
+            }
+            if constexpr (Dialect::kColumns != Columns::kNone) {
+                while (ValidPosition() && Current() != '\n') {
+                    Advance();
+                }
+            }
+            if (ValidPosition() && Current() != '\n') {
+                return false;
+            }
+            if constexpr (Dialect::kOneBased) {
+                if (u == 0 || v == 0) {
+                    return false;
+                }
+                --u;
+                --v;
+            }
+            SkipToEdge<Dialect>();
+            return true;
+        }
+    }
+
     [[nodiscard]] inline bool ValidPosition() const {
-        return _position < _length;
+        return _position < _end;
     }
 
     [[nodiscard]] inline char Current() const { return _contents[_position]; }
 
     inline void Advance() { ++_position; }
 
+    inline void Seek(const std::size_t position) { _position = position; }
+
+    // Stops scanning at `end`, e.g., to process only a chunk of the file.
+    inline void Limit(const std::size_t end) { _end = std::min(end, _length); }
+
     [[nodiscard]] inline std::size_t Position() const { return _position; }
 
     [[nodiscard]] inline std::size_t Length() const { return _length; }
 
+    [[nodiscard]] inline const char *Data() const { return _contents; }
+
    private:
+    // Scans a number followed by separators within the line.
+    template <typename Dialect>
+    inline bool ScanColumn(std::uint64_t &number) {
+        if (!ValidPosition() || !std::isdigit(Current())) {
+            return false;
+        }
+        number = 0;
+        while (ValidPosition() && std::isdigit(Current())) {
+            number = number * 10 + (Current() - '0');
+            Advance();
+        }
+        while (ValidPosition() &&
+               (Current() == ' ' || Current() == '\t' || Current() == '\r' ||
+                (Dialect::kCommas && Current() == ','))) {
+            Advance();
+        }
+        return true;
+    }
+
     int _fd = 0;
     std::size_t _position = 0;
     std::size_t _length = 0;
+    std::size_t _end = 0;
     char *_contents = nullptr;
 };
 
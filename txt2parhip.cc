@@ -0,0 +1,240 @@
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "parhip.h"
+#include "pipeline.h"
+#include "report.h"
+#include "toker.h"
+
+using namespace hyperlink;
+
+using NodeID = std::uint32_t;
+
+// Converts a text edge list to an undirected ParHiP graph in a single process,
+// replacing txt2sbin -> revsbin -> edges2parhip. Edges are parsed, sorted,
+// deduplicated and symmetrized in memory; only if the memory budget does not
+// suffice, sorted runs are spilled to disk and merged while writing the
+// graph.
+int main(int argc, const char *argv[]) {
+    report::Init(argc, argv);
+
+    if (argc < 4) {
+        std::cerr << "usage: ./txt2parhip <memory budget in GB> <input.txt> "
+                     "<output.parhip> [<directory for spilled runs>]\n";
+        std::exit(1);
+    }
+
+    const std::uint64_t budget =
+        static_cast<std::uint64_t>(std::stod(argv[1]) * 1024 * 1024 * 1024);
+    const std::string input_filename = argv[2];
+    const std::string output_filename = argv[3];
+    const std::filesystem::path run_directory =
+        (argc < 5) ? std::filesystem::path(output_filename).parent_path()
+                   : std::filesystem::path(argv[4]);
+
+    if (std::ifstream in(input_filename); !in) {
+        std::cerr << "error: could not open input file\n";
+        std::exit(1);
+    }
+    if (std::ifstream test_out(output_filename, std::ios::binary); test_out) {
+        std::cerr << "error: output file already exists\n";
+        std::exit(1);
+    }
+
+    std::ofstream out(output_filename, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cerr << "error: could not open output file\n";
+        std::exit(1);
+    }
+
+    // Each run is symmetrized in place, thus only half of the buffer can be
+    // filled while parsing
+    const std::uint64_t capacity = budget / sizeof(Edge<NodeID>);
+    const std::uint64_t run_size = capacity / 2;
+    if (run_size == 0) {
+        std::cerr << "error: memory budget too small\n";
+        std::exit(1);
+    }
+
+    std::cout << "In:  " << input_filename << std::endl;
+    std::cout << "Out: " << output_filename << std::endl;
+    std::cout << "Memory budget: " << budget / 1024 / 1024 << " MB = "
+              << run_size << " edges per run" << std::endl;
+
+    std::vector<Edge<NodeID>> edges;
+    edges.reserve(capacity);
+
+    MappedFileToker toker(input_filename);
+
+    std::uint64_t edges_read = 0;
+    std::uint64_t self_loops_removed = 0;
+    std::uint64_t duplicates_removed = 0;
+    parhip::ID64 n = 0;
+    std::vector<std::string> run_filenames;
+
+    while (true) {
+        std::cout << "Parsing input file ... ("
+                  << toker.Position() / 1024 / 1024 / 1024 << " of "
+                  << toker.Length() / 1024 / 1024 / 1024 << " GB) ..."
+                  << std::endl;
+        edges.clear();
+        {
+            report::ScopedPhase phase("parse");
+            const std::size_t position = toker.Position();
+            const std::uint64_t self_loops_before = self_loops_removed;
+            if (!ParseCanonicalEdges<NodeID>(toker, edges, run_size,
+                                             self_loops_removed)) {
+                std::cerr << "error: malformed line at byte "
+                          << toker.Position() << "\n";
+                std::exit(1);
+            }
+            edges_read += edges.size();
+            report::AddBytesRead(toker.Position() - position);
+            report::AddEdges(edges.size() + self_loops_removed -
+                             self_loops_before);
+        }
+
+        {
+            report::ScopedPhase phase("sort");
+            std::cout << "Sorting edges and removing duplicates ..."
+                      << std::endl;
+            report::AddEdges(edges.size());
+            duplicates_removed += SortAndRemoveDuplicates(edges);
+
+            std::cout << "Generating reverse edges ..." << std::endl;
+            Symmetrize(edges);
+        }
+        if (!edges.empty()) {
+            n = std::max<parhip::ID64>(n, edges.back().first + 1ull);
+        }
+
+        if (!toker.ValidPosition()) {
+            break;
+        }
+
+        const std::string run_filename =
+            (run_directory /
+             (std::filesystem::path(output_filename).filename().string() +
+              ".run" + std::to_string(run_filenames.size())))
+                .string();
+        std::cout << "Spilling " << edges.size() << " edges to "
+                  << run_filename << " ..." << std::endl;
+
+        report::ScopedPhase phase("spill");
+        std::ofstream run(run_filename, std::ios::binary | std::ios::trunc);
+        if (!run) {
+            std::cerr << "error: cannot write to " << run_filename << "\n";
+            std::exit(1);
+        }
+        run.write(reinterpret_cast<const char *>(edges.data()),
+                  sizeof(Edge<NodeID>) * edges.size());
+        run_filenames.push_back(run_filename);
+        report::AddBytesWritten(sizeof(Edge<NodeID>) * edges.size());
+        report::AddEdges(edges.size());
+    }
+
+    parhip::Header header{
+        .version =
+            {
+                .has_edge_weights = false,
+                .has_vertex_weights = false,
+                .has_32bit_edge_ids = false,
+                .has_32bit_vertex_ids = sizeof(NodeID) == 4,
+                .has_32bit_vertex_weights = false,
+                .has_32bit_edge_weights = false,
+            },
+        .n = n,
+        .m = 0,
+    };
+
+    std::cout << "There are " << n << " nodes" << std::endl;
+    std::cout << "Merging " << run_filenames.size() + 1
+              << " run(s) and writing adjncy[] ..." << std::endl;
+
+    std::vector<parhip::ID64> xadj(n + 1);
+
+    {
+        report::ScopedPhase phase("merge");
+        RunMerger<NodeID> merger;
+        for (const std::string &run_filename : run_filenames) {
+            merger.AddFile(run_filename);
+        }
+        merger.AddMemory(edges.data(), edges.data() + edges.size());
+
+        constexpr std::size_t buf_size = 1ull * 1024 * 1024;
+        std::vector<NodeID> adjncy;
+        adjncy.reserve(buf_size);
+
+        out.seekp(parhip::AdjncyOffset(header), std::ios_base::beg);
+
+        // Runs were deduplicated individually, but can still share edges
+        Edge<NodeID> prev = {std::numeric_limits<NodeID>::max(),
+                             std::numeric_limits<NodeID>::max()};
+        std::uint64_t duplicates_across_runs = 0;
+
+        merger.ForEachEdge([&](const Edge<NodeID> &edge) {
+            if (edge == prev) {
+                ++duplicates_across_runs;
+                return;
+            }
+            prev = edge;
+
+            ++xadj[edge.first];
+            adjncy.push_back(edge.second);
+            if (adjncy.size() == buf_size) {
+                out.write(reinterpret_cast<const char *>(adjncy.data()),
+                          adjncy.size() * sizeof(NodeID));
+                header.m += adjncy.size();
+                adjncy.clear();
+            }
+        });
+        out.write(reinterpret_cast<const char *>(adjncy.data()),
+                  adjncy.size() * sizeof(NodeID));
+        header.m += adjncy.size();
+
+        // Every undirected duplicate was merged in both directions
+        duplicates_removed += duplicates_across_runs / 2;
+
+        const std::uint64_t merged = header.m + duplicates_across_runs;
+        report::AddBytesRead((merged - edges.size()) * sizeof(Edge<NodeID>));
+        report::AddBytesWritten(header.m * sizeof(NodeID));
+        report::AddEdges(merged);
+    }
+
+    std::cout << "There are " << n << " nodes and " << header.m << " edges"
+              << std::endl;
+    std::cout << "Writing header and xadj[] ..." << std::endl;
+
+    {
+        report::ScopedPhase phase("write_xadj");
+        parhip::DegreesToXadj(header, xadj);
+        out.seekp(0, std::ios_base::beg);
+        parhip::WriteHeader(out, header);
+        out.write(reinterpret_cast<const char *>(xadj.data()),
+                  xadj.size() * sizeof(parhip::ID64));
+        report::AddBytesWritten(parhip::AdjncyOffset(header));
+    }
+
+    if (!out) {
+        std::cerr << "error: failed to write output file\n";
+        std::exit(1);
+    }
+
+    for (const std::string &run_filename : run_filenames) {
+        std::filesystem::remove(run_filename);
+    }
+
+    std::cout << "\tEdges read:         " << edges_read + self_loops_removed
+              << std::endl;
+    std::cout << "\tEdges kept:         " << header.m / 2 << std::endl;
+    std::cout << "\tDuplicates removed: " << duplicates_removed << std::endl;
+    std::cout << "\tSelf-loops removed: " << self_loops_removed << std::endl;
+    std::cout << "Done." << std::endl;
+}
@@ -1,115 +1,448 @@
 #include <algorithm>
 #include <cstdint>
+#include <exception>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <limits>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "allocator.h"
+#include "checksum.h"
+#include "checkpoint.h"
+#include "flags.h"
 #include "ips4o.hpp"
+#include "pipeline.h"
+#include "report.h"
 #include "toker.h"
 
 using namespace hyperlink;
 
 using NodeID = std::uint32_t;
+using Edges = Buffer<std::pair<NodeID, NodeID>>;
+
+// Number of edges parsed between two checkpoints.
+constexpr std::uint64_t kCheckpointInterval = 1ull << 30;
+
+// Parsers specialized for the dialect of the input, see pipeline.h.
+using ParseFunction = bool (*)(MappedFileToker &, Edges &, std::uint64_t,
+                               std::uint64_t &, Buffer<EdgeWeight> *);
+using ParseFilesFunction = bool (*)(const std::vector<std::string> &, Edges &,
+                                    std::uint64_t, std::uint64_t &,
+                                    Buffer<EdgeWeight> *);
+
+DialectOptions ExtractDialect(int &argc, const char *argv[]) {
+    DialectOptions options;
+    options.comments = ExtractSwitch(argc, argv, "comments");
+    options.commas = ExtractSwitch(argc, argv, "csv");
+    options.one_based = ExtractSwitch(argc, argv, "one-based");
+
+    const std::string columns = ExtractFlag(argc, argv, "columns", "none");
+    if (columns == "skip") {
+        options.columns = Columns::kSkip;
+    } else if (columns == "weight") {
+        options.columns = Columns::kWeight;
+    } else if (columns != "none") {
+        std::cerr << "error: --columns must be none, skip or weight\n";
+        std::exit(1);
+    }
+    return options;
+}
+
+std::string DescribeDialect(const DialectOptions &options) {
+    const char *columns[] = {"none", "skip", "weight"};
+    return std::string("comments=") + (options.comments ? "1" : "0") +
+           " csv=" + (options.commas ? "1" : "0") +
+           " columns=" + columns[static_cast<int>(options.columns)] +
+           " one-based=" + (options.one_based ? "1" : "0");
+}
+
+void WriteChecksums(const std::string &filename, const void *data,
+                    const std::uint64_t bytes) {
+    try {
+        checksum::WriteSidecar(filename, data, bytes);
+    } catch (const std::exception &e) {
+        std::cerr << "error: " << e.what() << "\n";
+        std::exit(1);
+    }
+}
+
+void WriteWeights(const std::string &filename,
+                  const Buffer<EdgeWeight> &weights) {
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char *>(weights.data()),
+              sizeof(EdgeWeight) * weights.size());
+    out.flush();
+    if (!out) {
+        std::cerr << "error: cannot write to " << filename << "\n";
+        std::exit(1);
+    }
+    report::AddBytesWritten(sizeof(EdgeWeight) * weights.size());
+    WriteChecksums(filename, weights.data(),
+                   sizeof(EdgeWeight) * weights.size());
+}
+
+int main(int argc, const char *argv[]) {
+    report::Init(argc, argv);
+    const std::string checkpoint_directory =
+        ExtractFlag(argc, argv, "checkpoint");
+    const DialectOptions dialect = ExtractDialect(argc, argv);
+    const bool weight_column = dialect.columns == Columns::kWeight;
+    const bool weighted = ExtractSwitch(argc, argv, "weights") || weight_column;
 
-int main(const int argc, const char *argv[]) {
     if (argc < 4) {
-        std::cerr << "usage: ./txt2sbin <upper bound on the number of edges in "
-                     "billions> <input.txt> <output.bin> [<output.rev.bin>]\n";
+        std::cerr << "usage: ./txt2sbin [--checkpoint=<directory>] "
+                     "[--weights] [--comments] [--csv] [--one-based] "
+                     "[--columns=<none|skip|weight>] <upper bound on the "
+                     "number of edges in billions, or auto> <input.txt or "
+                     "glob> <output.bin> [<output.rev.bin>]\n";
+        std::cerr << "With auto, the edge buffer can grow up to the size of "
+                     "the physical memory.\n";
+        std::cerr << "With --weights, duplicates are counted instead of "
+                     "dropped and the counts are written to <output>.weights."
+                     "\n";
+        std::cerr << "Input dialect: --comments skips lines starting with # "
+                     "or %, --csv also accepts commas as separators, "
+                     "--one-based shifts IDs to start at 0, --columns=skip "
+                     "ignores further columns and --columns=weight sums the "
+                     "third column over duplicates instead of counting them "
+                     "(implies --weights).\n";
         std::exit(1);
     }
+    if (weight_column && !checkpoint_directory.empty()) {
+        std::cerr << "error: --columns=weight is not supported with "
+                     "--checkpoint\n";
+        std::exit(1);
+    }
+
+    ParseFunction parse = nullptr;
+    ParseFilesFunction parse_files = nullptr;
+    VisitDialect(dialect, [&]<typename Dialect>(Dialect) {
+        parse = &ParseCanonicalEdges<NodeID, Dialect, Edges,
+                                     Buffer<EdgeWeight>>;
+        parse_files = &ParseCanonicalEdgesFromFiles<NodeID, Dialect, Edges,
+                                                    Buffer<EdgeWeight>>;
+    });
 
+    // The edge buffer only reserves address space for max_edges edges; its
+    // pages are committed while parsing
     const std::uint64_t max_edges =
-        static_cast<std::uint64_t>(std::stoull(argv[1]) * 1'000'000'000);
+        std::string(argv[1]) == "auto"
+            ? PhysicalMemory() / sizeof(std::pair<NodeID, NodeID>)
+            : static_cast<std::uint64_t>(std::stoull(argv[1]) *
+                                         1'000'000'000);
 
-    const std::string input_filename = argv[2];
+    const std::vector<std::string> input_filenames = ExpandGlob(argv[2]);
     const std::string output_filename = argv[3];
     const std::string output_rev_filename = (argc < 5) ? "" : argv[4];
 
-    if (std::ifstream in(input_filename); !in) {
-        std::cerr << "error: could not open input file\n";
-        std::exit(1);
+    for (const std::string &input_filename : input_filenames) {
+        if (std::ifstream in(input_filename); !in) {
+            std::cerr << "error: could not open input file " << input_filename
+                      << "\n";
+            std::exit(1);
+        }
     }
 
-    if (std::ofstream out(output_filename, std::ios::binary); !out) {
+    // Opened for appending to keep the output of an interrupted run intact
+    if (std::ofstream out(output_filename, std::ios::binary | std::ios::app);
+        !out) {
         std::cerr << "error: could not open output file\n";
         std::exit(1);
     }
-    if (std::ofstream out(output_rev_filename, std::ios::binary); !out) {
+    if (std::ofstream out(output_rev_filename,
+                          std::ios::binary | std::ios::app);
+        !output_rev_filename.empty() && !out) {
         std::cerr << "error: could not open reverse output file\n";
         std::exit(1);
     }
 
+    checkpoint::Checkpoint checkpoint;
+    if (!checkpoint_directory.empty()) {
+        checkpoint = checkpoint::Checkpoint(
+            checkpoint_directory,
+            checkpoint::Fingerprint(
+                input_filenames, output_filename + " " + output_rev_filename +
+                                     (weighted ? " weights " : " ") +
+                                     DescribeDialect(dialect)));
+    }
+
     std::cout << "Upper bound on the number of edges: " << max_edges
               << std::endl;
-    std::cout << "In:  " << input_filename << std::endl;
+    for (const std::string &input_filename : input_filenames) {
+        std::cout << "In:  " << input_filename << std::endl;
+    }
     std::cout << "Out: " << output_filename << std::endl;
+    std::cout << "Dialect: " << DescribeDialect(dialect) << std::endl;
     if (!output_rev_filename.empty()) {
         std::cout << "Out: " << output_rev_filename << " [rev edges]"
                   << std::endl;
     }
 
-    std::vector<std::pair<NodeID, NodeID>> edges;
+    Edges edges;
     edges.reserve(max_edges);
+    Buffer<EdgeWeight> weights;
+    if (weight_column) {
+        weights.reserve(max_edges);
+    }
 
-    std::cout << "Preallocated edge buffer: "
+    std::cout << "Reserved edge buffer: "
               << (sizeof(std::pair<NodeID, NodeID>) * max_edges) / 1024 / 1024 /
                      1024
               << " GB" << std::endl;
 
-    MappedFileToker toker(input_filename);
+    if (checkpoint.Get("output_written") == 0) {
+        const std::uint64_t estimated_edges = EstimateLines(input_filenames);
+        std::cout << "Estimated number of edges: " << estimated_edges << " ("
+                  << sizeof(std::pair<NodeID, NodeID>) * estimated_edges /
+                         1024 / 1024 / 1024
+                  << " GB)" << std::endl;
+        report::SetProperty("estimated_edges",
+                            std::to_string(estimated_edges));
 
-    std::cout << "Parsing input file ... ("
-              << toker.Length() / 1024 / 1024 / 1024 << " GB) ..." << std::endl;
+        if (estimated_edges > max_edges) {
+            std::cerr << "warning: the input probably has more edges than "
+                         "the upper bound\n";
+        }
+        if (sizeof(std::pair<NodeID, NodeID>) * estimated_edges >
+            PhysicalMemory()) {
+            std::cerr << "warning: the edges probably do not fit into "
+                         "memory\n";
+        }
+    }
+
+    std::uint64_t self_loops_removed = checkpoint.Get("self_loops_removed");
+    std::uint64_t duplicates_removed = checkpoint.Get("duplicates_removed");
 
-    toker.SkipSpaces();
-    std::uint64_t self_loops_removed = 0;
-    while (toker.ValidPosition()) {
-        const NodeID u = static_cast<NodeID>(toker.ScanUInt());
-        const NodeID v = static_cast<NodeID>(toker.ScanUInt());
+    if (checkpoint.Get("output_written") == 1) {
+        std::cout << "Output file was already written, reading it ..."
+                  << std::endl;
+
+        std::ifstream in(output_filename, std::ios::binary);
+        const std::uint64_t size = checkpoint.Get("num_edges");
+        edges.resize(size);
+        in.read(reinterpret_cast<char *>(edges.data()),
+                sizeof(std::pair<NodeID, NodeID>) * size);
 
-        if (u < v) {
-            edges.emplace_back(u, v);
-        } else if (v < u) {
-            edges.emplace_back(v, u);
-        } else {
-            ++self_loops_removed;
+        std::ifstream weights_in(WeightsFilename(output_filename),
+                                 std::ios::binary);
+        if (weighted) {
+            weights.resize(size);
+            weights_in.read(reinterpret_cast<char *>(weights.data()),
+                            sizeof(EdgeWeight) * size);
         }
 
-        if (sizeof(std::pair<NodeID, NodeID>) * edges.size() %
-                (1024 * 1024 * 1024) ==
-            0) {
-            std::cout << "\t" << toker.Position() / 1024 / 1024 / 1024
-                      << " GB, removed " << self_loops_removed
-                      << " self-loops (= "
-                      << sizeof(std::pair<NodeID, NodeID>) *
-                             self_loops_removed / 1024 / 1024 / 1024
-                      << " GB)..." << std::endl;
+        if (!in || (weighted && !weights_in)) {
+            std::cerr << "error: output file is truncated, remove the "
+                         "checkpoint to start over\n";
+            std::exit(1);
         }
-    }
+    } else {
+        for (std::uint64_t r = 0; r < checkpoint.Get("runs"); ++r) {
+            const std::string run_filename =
+                checkpoint.Path("run" + std::to_string(r));
+            const std::uint64_t size =
+                checkpoint.Get("run" + std::to_string(r) + "_edges");
+            std::cout << "Reading " << size << " edges from " << run_filename
+                      << " ..." << std::endl;
 
-    std::cout << "Sorting edges ..." << std::endl;
-    ips4o::parallel::sort(edges.begin(), edges.end());
-
-    const std::uint64_t edges_before_removing_duplicates = edges.size();
-    std::cout << "Removing duplicate edges ..." << std::endl;
-    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
-    const std::uint64_t edges_after_removing_duplicates = edges.size();
-    const std::uint64_t duplicates_removed =
-        edges_before_removing_duplicates - edges_after_removing_duplicates;
-    std::cout << "\tRemoved " << duplicates_removed << " duplicates (= "
-              << sizeof(std::pair<NodeID, NodeID>) * duplicates_removed / 1024 /
-                     1024 / 1024
-              << " GB)" << std::endl;
-
-    std::cout << "Writing output file ..." << std::endl;
-
-    {
-        std::ofstream output(output_filename,
-                             std::ios::binary | std::ios::trunc);
-        output.write(reinterpret_cast<const char *>(edges.data()),
-                     sizeof(std::pair<NodeID, NodeID>) * edges.size());
+            std::ifstream in(run_filename, std::ios::binary);
+            const std::size_t offset = edges.size();
+            edges.resize(offset + size);
+            in.read(reinterpret_cast<char *>(edges.data() + offset),
+                    sizeof(std::pair<NodeID, NodeID>) * size);
+            if (!in) {
+                std::cerr << "error: checkpoint " << run_filename
+                          << " is truncated, remove the checkpoint to start "
+                             "over\n";
+                std::exit(1);
+            }
+        }
+        std::uint64_t input_size = 0;
+        for (const std::string &input_filename : input_filenames) {
+            input_size += std::filesystem::file_size(input_filename);
+        }
+        std::cout << "Parsing " << input_filenames.size()
+                  << " input file(s) ... (" << input_size / 1024 / 1024 / 1024
+                  << " GB) ..." << std::endl;
+
+        {
+            report::ScopedPhase phase("parse");
+
+            if (!checkpoint.Enabled()) {
+                const std::uint64_t self_loops_before = self_loops_removed;
+                bool fits = false;
+                try {
+                    fits = parse_files(input_filenames, edges, max_edges,
+                                       self_loops_removed,
+                                       weight_column ? &weights : nullptr);
+                } catch (const std::exception &e) {
+                    std::cerr << "error: " << e.what() << "\n";
+                    std::exit(1);
+                }
+                if (!fits) {
+                    std::cerr << "error: input has more than " << max_edges
+                              << " edges, increase the upper bound\n";
+                    std::exit(1);
+                }
+                report::AddEdges(edges.size() + self_loops_removed -
+                                 self_loops_before);
+                report::AddBytesRead(input_size);
+            }
+
+            // With checkpointing, the files are parsed one after another and
+            // every chunk is persisted as a sorted run; a chunk can span
+            // several files
+            const std::uint64_t first_file = checkpoint.Get("input_file");
+            const std::uint64_t first_position =
+                checkpoint.Get("input_position");
+            std::size_t begin = edges.size();
+
+            for (std::uint64_t f = first_file;
+                 checkpoint.Enabled() && f < input_filenames.size(); ++f) {
+                MappedFileToker toker(input_filenames[f]);
+                if (f == first_file) {
+                    toker.Seek(first_position);
+                }
+                const std::size_t position = toker.Position();
+
+                while (true) {
+                    const std::size_t size_before = edges.size();
+                    const std::uint64_t self_loops_before = self_loops_removed;
+                    if (!parse(toker, edges,
+                               std::min(begin + kCheckpointInterval, max_edges),
+                               self_loops_removed, nullptr)) {
+                        std::cerr << "error: malformed line in "
+                                  << input_filenames[f] << " at byte "
+                                  << toker.Position() << "\n";
+                        std::exit(1);
+                    }
+                    report::AddEdges(edges.size() - size_before +
+                                     self_loops_removed - self_loops_before);
+
+                    // Growing beyond the reserved buffer would copy it
+                    if (edges.size() == max_edges) {
+                        toker.SkipSpaces();
+                        if (toker.ValidPosition()) {
+                            std::cerr << "error: input has more than "
+                                      << max_edges
+                                      << " edges, increase the upper bound\n";
+                            std::exit(1);
+                        }
+                    }
+
+                    if (!toker.ValidPosition()) {
+                        break;
+                    }
+
+                    // Without weights, duplicates are removed per run;
+                    // weighted runs keep them so that the merge can sum their
+                    // counts
+                    SortEdges(edges.begin() + begin, edges.end());
+                    if (!weighted) {
+                        const auto end = std::unique(edges.begin() + begin,
+                                                     edges.end());
+                        duplicates_removed += edges.end() - end;
+                        edges.erase(end, edges.end());
+                    }
+
+                    const std::uint64_t r = checkpoint.Get("runs");
+                    const std::string run_filename =
+                        checkpoint.Path("run" + std::to_string(r));
+                    std::cout << "\tCheckpointing " << edges.size() - begin
+                              << " edges to " << run_filename << " ..."
+                              << std::endl;
+                    {
+                        std::ofstream run(run_filename,
+                                          std::ios::binary | std::ios::trunc);
+                        run.write(reinterpret_cast<const char *>(
+                                      edges.data() + begin),
+                                  sizeof(std::pair<NodeID, NodeID>) *
+                                      (edges.size() - begin));
+                        run.flush();
+                        if (!run) {
+                            std::cerr << "error: cannot write to "
+                                      << run_filename << "\n";
+                            std::exit(1);
+                        }
+                    }
+
+                    checkpoint.Set("run" + std::to_string(r) + "_edges",
+                                   edges.size() - begin);
+                    checkpoint.Set("runs", r + 1);
+                    checkpoint.Set("input_file", f);
+                    checkpoint.Set("input_position", toker.Position());
+                    checkpoint.Set("self_loops_removed", self_loops_removed);
+                    checkpoint.Set("duplicates_removed", duplicates_removed);
+                    checkpoint.Commit({run_filename});
+
+                    begin = edges.size();
+                }
+
+                report::AddBytesRead(toker.Length() - position);
+            }
+        }
+
+        numa::ReportPlacement("edges", edges.data(),
+                              sizeof(std::pair<NodeID, NodeID>) * edges.size());
+        huge_pages::ReportCoverage(
+            "edges", edges.data(),
+            sizeof(std::pair<NodeID, NodeID>) * edges.size());
+
+        std::cout << "Sorting edges and removing duplicates ..." << std::endl;
+        {
+            report::ScopedPhase phase("sort");
+            report::AddEdges(edges.size());
+            if (weight_column) {
+                duplicates_removed += SortAndSumDuplicates(edges, weights);
+            } else if (weighted) {
+                duplicates_removed += SortAndCountDuplicates(edges, weights);
+            } else {
+                duplicates_removed += SortAndRemoveDuplicates(edges);
+            }
+        }
+        std::cout << "\tRemoved " << duplicates_removed << " duplicates (= "
+                  << sizeof(std::pair<NodeID, NodeID>) * duplicates_removed /
+                         1024 / 1024 / 1024
+                  << " GB)" << std::endl;
+
+        std::cout << "Writing output file ..." << std::endl;
+
+        {
+            report::ScopedPhase phase("write");
+            std::ofstream output(output_filename,
+                                 std::ios::binary | std::ios::trunc);
+            output.write(reinterpret_cast<const char *>(edges.data()),
+                         sizeof(std::pair<NodeID, NodeID>) * edges.size());
+            output.flush();
+            report::AddBytesWritten(sizeof(std::pair<NodeID, NodeID>) *
+                                    edges.size());
+            report::AddEdges(edges.size());
+            WriteChecksums(output_filename, edges.data(),
+                           sizeof(std::pair<NodeID, NodeID>) * edges.size());
+
+            if (weighted) {
+                WriteWeights(WeightsFilename(output_filename), weights);
+            }
+        }
+
+        checkpoint.Set("output_written", 1);
+        checkpoint.Set("num_edges", edges.size());
+        checkpoint.Set("self_loops_removed", self_loops_removed);
+        checkpoint.Set("duplicates_removed", duplicates_removed);
+
+        std::vector<std::string> data_filenames = {
+            output_filename, checksum::SidecarFilename(output_filename)};
+        if (weighted) {
+            const std::string weights_filename =
+                WeightsFilename(output_filename);
+            data_filenames.push_back(weights_filename);
+            data_filenames.push_back(
+                checksum::SidecarFilename(weights_filename));
+        }
+        checkpoint.Commit(data_filenames);
     }
 
     std::cout << "\tEdges read:         "
@@ -120,6 +453,8 @@ int main(const int argc, const char *argv[]) {
     std::cout << "\tSelf-loops removed: " << self_loops_removed << std::endl;
 
     if (!output_rev_filename.empty()) {
+        report::ScopedPhase phase("write_rev");
+
         std::cout << "Generating reverse edges ..." << std::endl;
         for (auto &[u, v] : edges) {
             std::swap(u, v);
@@ -132,7 +467,19 @@ int main(const int argc, const char *argv[]) {
             output.write(reinterpret_cast<const char *>(edges.data()),
                          sizeof(std::pair<NodeID, NodeID>) * edges.size());
         }
+        report::AddBytesWritten(sizeof(std::pair<NodeID, NodeID>) *
+                                edges.size());
+        report::AddEdges(edges.size());
+        WriteChecksums(output_rev_filename, edges.data(),
+                       sizeof(std::pair<NodeID, NodeID>) * edges.size());
+
+        // Reversing the edges in place keeps the order of the weights
+        if (weighted) {
+            WriteWeights(WeightsFilename(output_rev_filename), weights);
+        }
     }
 
+    checkpoint.Remove();
+
     std::cout << "Done." << std::endl;
 }
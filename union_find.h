@@ -0,0 +1,137 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+
+#include "allocator.h"
+#include "parallel.h"
+#include "parhip.h"
+
+namespace hyperlink {
+
+// Lock-free union-find over [0, n) for concurrent Union() and Find() calls.
+// Roots are always linked below roots with a smaller ID, which rules out
+// cycles without ranks; Find() halves paths with compare-and-swap, which
+// may fail harmlessly if another thread got there first.
+template <typename ID>
+class UnionFind {
+   public:
+    explicit UnionFind(const std::uint64_t n) : _parent(n) {
+        ParallelFor(0, n, 1ull << 16,
+                    [&](int, const std::uint64_t first,
+                        const std::uint64_t last) {
+                        for (std::uint64_t u = first; u < last; ++u) {
+                            _parent[u] = static_cast<ID>(u);
+                        }
+                    });
+    }
+
+    [[nodiscard]] ID Find(ID u) {
+        while (true) {
+            ID parent = Parent(u).load(std::memory_order_relaxed);
+            if (parent == u) {
+                return u;
+            }
+
+            const ID grandparent =
+                Parent(parent).load(std::memory_order_relaxed);
+            if (parent != grandparent) {
+                Parent(u).compare_exchange_weak(parent, grandparent,
+                                                std::memory_order_relaxed);
+            }
+            u = grandparent;
+        }
+    }
+
+    void Union(ID u, ID v) {
+        while (true) {
+            u = Find(u);
+            v = Find(v);
+            if (u == v) {
+                return;
+            }
+            if (u < v) {
+                std::swap(u, v);
+            }
+
+            // Fails if u stopped being a root in the meantime
+            ID expected = u;
+            if (Parent(u).compare_exchange_strong(expected, v,
+                                                  std::memory_order_relaxed)) {
+                return;
+            }
+        }
+    }
+
+    [[nodiscard]] std::uint64_t Size() const { return _parent.size(); }
+
+   private:
+    std::atomic_ref<ID> Parent(const ID u) {
+        return std::atomic_ref<ID>(_parent[u]);
+    }
+
+    Buffer<ID> _parent;
+};
+
+// Weakly connected components, i.e., edge directions are ignored.
+template <typename VertexID>
+struct Components {
+    // Root of the component of every vertex.
+    Buffer<VertexID> roots;
+    // Size of the component rooted at every vertex, 0 if it is not a root.
+    Buffer<VertexID> sizes;
+};
+
+// Finds the components by a single union-find pass over the edges; component
+// sizes are then accumulated at the roots. Throws if a neighbor is out of
+// range.
+template <typename EdgeID, typename VertexID>
+Components<VertexID> FindComponents(
+    const parhip::GraphView<EdgeID, VertexID> &graph) {
+    constexpr std::uint64_t kGrainSize = 4096;
+    const std::uint64_t n = graph.n;
+    UnionFind<VertexID> union_find(n);
+
+    std::atomic<bool> out_of_range = false;
+    ParallelFor(0, n, kGrainSize,
+                [&](int, const std::uint64_t first, const std::uint64_t last) {
+                    for (std::uint64_t u = first; u < last; ++u) {
+                        const VertexID *begin =
+                            graph.adjncy + graph.FirstEdge(u);
+                        const VertexID *end = begin + graph.Degree(u);
+                        for (const VertexID *it = begin; it != end; ++it) {
+                            if (*it >= n) {
+                                out_of_range = true;
+                                continue;
+                            }
+                            union_find.Union(static_cast<VertexID>(u), *it);
+                        }
+                    }
+                });
+    if (out_of_range) {
+        throw std::runtime_error("input graph has out-of-range neighbors");
+    }
+
+    Components<VertexID> components{Buffer<VertexID>(n), Buffer<VertexID>(n)};
+    ParallelFor(0, n, kGrainSize * 16,
+                [&](int, const std::uint64_t first, const std::uint64_t last) {
+                    std::fill(components.sizes.begin() + first,
+                              components.sizes.begin() + last, 0);
+                });
+    ParallelFor(0, n, kGrainSize,
+                [&](int, const std::uint64_t first, const std::uint64_t last) {
+                    for (std::uint64_t u = first; u < last; ++u) {
+                        const VertexID root =
+                            union_find.Find(static_cast<VertexID>(u));
+                        components.roots[u] = root;
+                        std::atomic_ref<VertexID>(components.sizes[root])
+                            .fetch_add(1, std::memory_order_relaxed);
+                    }
+                });
+    return components;
+}
+
+}  // namespace hyperlink